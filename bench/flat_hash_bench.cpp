@@ -0,0 +1,134 @@
+// Times the flat_hash.h containers against the std::unordered_* typedefs of core.h they
+// stand in for: insert, find (hits and misses) and erase of n integer grid keys.
+//
+//   g++ -std=c++14 -O2 -I../src -I<eigen> flat_hash_bench.cpp
+//   ./a.out [n]
+
+#include "core.h"
+#include "flat_hash.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+static double now()
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Random keys within a cube of side about 4 * n^(1/N), and as many keys absent from it
+template <typename K>
+static void makeKeys(size_t n, mg::EigList<K> &keys, mg::EigList<K> &misses)
+{
+    const int N = K::RowsAtCompileTime;
+    int side = 4 * (int)std::pow((double)n, 1.0 / N);
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int> d(0, side);
+
+    mg::FlatEigSet<K, mg::Vec_hash<int, N> > seen;
+    while (keys.size() < n) {
+        K k;
+        for (int i = 0; i < N; i++)
+            k[i] = d(rng);
+        if (seen.insert(k).second)
+            keys.push_back(k);
+    }
+    while (misses.size() < n) {
+        K k;
+        for (int i = 0; i < N; i++)
+            k[i] = d(rng);
+        if (seen.count(k) == 0)
+            misses.push_back(k);
+    }
+}
+
+struct times
+{
+    double insert, hit, miss, erase;
+    size_t check;
+};
+
+template <typename S, typename K>
+static times benchSet(const mg::EigList<K> &keys, const mg::EigList<K> &misses)
+{
+    times t;
+    S s;
+    double t0 = now();
+    for (const K &k : keys)
+        s.insert(k);
+    double t1 = now();
+    size_t found = 0;
+    for (const K &k : keys)
+        found += s.count(k);
+    double t2 = now();
+    for (const K &k : misses)
+        found += s.count(k);
+    double t3 = now();
+    for (const K &k : keys)
+        found += s.erase(k);
+    double t4 = now();
+
+    t.insert = t1 - t0;
+    t.hit = t2 - t1;
+    t.miss = t3 - t2;
+    t.erase = t4 - t3;
+    t.check = found + s.size();
+    return t;
+}
+
+template <typename M, typename K>
+static times benchMap(const mg::EigList<K> &keys, const mg::EigList<K> &misses)
+{
+    times t;
+    M m;
+    double t0 = now();
+    for (size_t i = 0; i < keys.size(); i++)
+        m[keys[i]] = (int)i;
+    double t1 = now();
+    size_t found = 0;
+    for (const K &k : keys)
+        found += m.find(k)->second;
+    double t2 = now();
+    for (const K &k : misses)
+        found += m.find(k) == m.end();
+    double t3 = now();
+    for (const K &k : keys)
+        found += m.erase(k);
+    double t4 = now();
+
+    t.insert = t1 - t0;
+    t.hit = t2 - t1;
+    t.miss = t3 - t2;
+    t.erase = t4 - t3;
+    t.check = found + m.size();
+    return t;
+}
+
+static void print(const char *name, const times &std, const times &flat)
+{
+    printf("%-28s insert %7.2f %7.2f   hit %7.2f %7.2f   miss %7.2f %7.2f   erase %7.2f %7.2f  %s\n", name,
+        std.insert, flat.insert, std.hit, flat.hit, std.miss, flat.miss, std.erase, flat.erase,
+        std.check == flat.check ? "" : "MISMATCH");
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = argc > 1 ? (size_t)atol(argv[1]) : 1000000;
+    printf("n %zu, ms as std flat\n", n);
+
+    mg::EigList<mg::Vec2i> keys2, misses2;
+    mg::EigList<mg::Vec3i> keys3, misses3;
+    makeKeys(n, keys2, misses2);
+    makeKeys(n, keys3, misses3);
+
+    print("EigSet2X<int> (VecSet2i)", benchSet<mg::VecSet2i>(keys2, misses2), benchSet<mg::FlatVecSet2i>(keys2, misses2));
+    print("EigSet<Vec3i> (VecSet3i)", benchSet<mg::VecSet3i>(keys3, misses3), benchSet<mg::FlatEigSet<mg::Vec3i> >(keys3, misses3));
+    print("EigSet<Vec3i, Vec_hash>",
+        benchSet<mg::EigSet<mg::Vec3i, mg::Vec_hash<int, 3> > >(keys3, misses3), benchSet<mg::FlatVecSet3i>(keys3, misses3));
+    print("EigMap<Vec3i, int, Vec_hash>",
+        benchMap<mg::EigMap<mg::Vec3i, int, mg::Vec_hash<int, 3> > >(keys3, misses3),
+        benchMap<mg::FlatEigMap<mg::Vec3i, int, mg::Vec_hash<int, 3> > >(keys3, misses3));
+
+    return 0;
+}
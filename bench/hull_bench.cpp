@@ -0,0 +1,50 @@
+// Times graham_scan::MonotoneChain against MonotoneChainParallel on gaussian point clouds
+// of growing size, to find where the parallel path starts paying off (its minPerThread).
+//
+//   g++ -std=c++14 -O2 -I../src -I<eigen> hull_bench.cpp ../src/graham_scan.cpp ../src/geom.cpp ../src/algs.cpp -pthread
+//   ./a.out [threads]
+
+#include "graham_scan.h"
+#include "parallel.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+// Best time of repeated calls to f, in milliseconds
+template <typename F>
+static double best(F f)
+{
+    double b = 1e300, total = 0;
+    for (int r = 0; r < 100 && (r < 3 || total < 200); r++)
+    {
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        b = std::min(b, ms);
+        total += ms;
+    }
+    return b;
+}
+
+int main(int argc, char **argv)
+{
+    int threads = mg::parallel::threadCount(argc > 1 ? atoi(argv[1]) : 0);
+    printf("threads %d\n%10s %12s %12s %8s\n", threads, "n", "seq ms", "par ms", "speedup");
+
+    std::mt19937 rng(1);
+    std::normal_distribution<double> d;
+    for (size_t n = 1 << 10; n <= (1 << 22); n *= 2)
+    {
+        mg::VecList2f P(n), H(n + 1), work(n);
+        for (mg::Vec2 &p : P)
+            p = mg::Vec2(d(rng), d(rng));
+
+        double seq = best([&]() { graham_scan::MonotoneChain(P.data(), n, H.data(), work.data()); });
+        double par = best([&]() { graham_scan::MonotoneChainParallel(P.data(), n, H.data(), threads, 1); });
+        printf("%10zu %12.3f %12.3f %8.2f\n", n, seq, par, seq / par);
+    }
+
+    return 0;
+}
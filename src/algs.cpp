@@ -2,6 +2,9 @@
 
 #include "geom.h"
 
+#include <algorithm>
+#include <limits>
+
 namespace mg 
 {
     namespace algs
@@ -80,6 +83,288 @@ namespace mg
             return res;
         }
 
+        int solveQuartic(double c4, double c3, double c2, double c1, double c0, cdouble solns[4])
+        {
+            if (std::abs(c4) < 1e-6) {
+                double c = c3, b = c2, a = c1, d = c0;
+                int nr;
+                double r[3];
+                solveCubic(&c, &b, &a, &d, 1, &nr, r, 2, solns);
+                solns[3] = std::numeric_limits<double>::quiet_NaN();
+                return nr;
+            }
+
+            // Depress: x = y - a/4, y^4 + p*y^2 + q*y + r = 0
+            double a = c3 / c4, b = c2 / c4, c = c1 / c4, d = c0 / c4;
+            double a2 = a * a;
+            double p = b - 3. * a2 / 8.;
+            double q = c - a * b / 2. + a2 * a / 8.;
+            double r = d - a * c / 4. + a2 * b / 16. - 3. * a2 * a2 / 256.;
+
+            cdouble y[4];
+            if (std::abs(q) < 1e-12 * (1. + std::abs(p) + std::abs(r)))
+            {
+                // Biquadratic: z^2 + p*z + r = 0, y = +-sqrt(z)
+                cdouble sd = std::sqrt(cdouble(p * p - 4. * r));
+                cdouble z1 = (-p + sd) / 2., z2 = (-p - sd) / 2.;
+                y[0] = std::sqrt(z1); y[1] = -y[0];
+                y[2] = std::sqrt(z2); y[3] = -y[2];
+            }
+            else
+            {
+                // Largest root of the resolvent 8m^3 + 8p*m^2 + (2p^2 - 8r)*m - q^2 = 0 is positive
+                double k3 = 8., k2 = 8. * p, k1 = 2. * p * p - 8. * r, k0 = -q * q;
+                int nr;
+                double m[3];
+                solveCubic(&k3, &k2, &k1, &k0, 1, &nr, m, 2);
+                double mm = std::max(m[nr - 1], 1e-300);
+
+                // (y^2 + p/2 + m)^2 = 2m*(y - q/(4m))^2
+                double s = std::sqrt(2. * mm);
+                double t = q / (2. * s);
+                cdouble d1 = std::sqrt(cdouble(2. * mm - 4. * (p / 2. + mm + t)));
+                cdouble d2 = std::sqrt(cdouble(2. * mm - 4. * (p / 2. + mm - t)));
+                y[0] = (s + d1) / 2.; y[1] = (s - d1) / 2.;
+                y[2] = (-s + d2) / 2.; y[3] = (-s - d2) / 2.;
+            }
+
+            int res = 0;
+            for (int i = 0; i < 4; i++)
+            {
+                // One Newton step on the original polynomial
+                cdouble x = y[i] - a / 4.;
+                cdouble f = (((x + a) * x + b) * x + c) * x + d;
+                cdouble df = ((4. * x + 3. * a) * x + 2. * b) * x + c;
+                if (std::abs(df) > 1e-300)
+                    x -= f / df;
+
+                if (std::abs(x.imag()) <= 1e-9 * (1. + std::abs(x.real()))) {
+                    x = x.real();
+                    res++;
+                }
+                solns[i] = x;
+            }
+
+            return res;
+        }
+
+        /**
+        * Batch root solvers
+        **/
+        // Equations are processed in blocks so the scratch space lives on the stack.
+        static const size_t ROOT_BLOCK = 256;
+
+        // Solves one SIMD pack of quadratics. Returns the masks of linear (c2 ~ 0) and complex
+        // lanes as bit sets, with the real roots (or real parts) in r0 <= r1 and imaginary parts in im.
+        static inline void quadraticPack(simd::packd a, simd::packd b, simd::packd c, int polish,
+            simd::packd &r0, simd::packd &r1, simd::packd &im, int &linBits, int &cpxBits, int &noneBits)
+        {
+            using namespace simd;
+            const packd zero = set1(0.), nan = set1(std::numeric_limits<double>::quiet_NaN());
+
+            packd D = fmadd(b, b, mul(set1(-4.), mul(a, c)));
+            maskd cpx = lt(D, zero);
+            maskd lin = lt(abs(a), set1(1e-6));
+            maskd bzero = lt(abs(b), set1(1e-300));
+
+            // Stable form: q = -(b + sign(b) sqrt(D)) / 2, x1 = q / a, x2 = c / q
+            packd s = sqrt(max(D, zero));
+            packd q = mul(set1(-0.5), add(b, select(lt(b, zero), sub(zero, s), s)));
+            packd x1 = div(q, a);
+            packd x2 = select(lt(abs(q), set1(1e-300)), x1, div(c, q));
+            packd xl = div(sub(zero, c), b);
+
+            // Newton steps are only kept when they reduce |f|, since near a double root the
+            // derivative vanishes and a step can leave a correct root
+            for (int k = 0; k < polish; k++)
+            {
+                packd twoa = add(a, a);
+                packd f1 = fmadd(fmadd(a, x1, b), x1, c), d1 = fmadd(twoa, x1, b);
+                packd f2 = fmadd(fmadd(a, x2, b), x2, c), d2 = fmadd(twoa, x2, b);
+                packd n1 = sub(x1, div(f1, d1)), n2 = sub(x2, div(f2, d2));
+                packd g1 = fmadd(fmadd(a, n1, b), n1, c), g2 = fmadd(fmadd(a, n2, b), n2, c);
+                x1 = select(lt(abs(g1), abs(f1)), n1, x1);
+                x2 = select(lt(abs(g2), abs(f2)), n2, x2);
+            }
+
+            packd re = div(b, mul(set1(-2.), a));
+            im = select(cpx, div(sqrt(sub(zero, D)), abs(add(a, a))), zero);
+            r0 = select(lin, xl, select(cpx, re, simd::min(x1, x2)));
+            r1 = select(lin, nan, select(cpx, re, simd::max(x1, x2)));
+
+            linBits = bits(lin);
+            cpxBits = bits(cpx);
+            noneBits = bits(bzero);
+        }
+
+        void solveQuadratic(const double *c2, const double *c1, const double *c0, size_t count,
+            int *nroots, double *roots, int polish, cdouble *csolns)
+        {
+            using namespace simd;
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+            double a[width], b[width], c[width], r0[width], r1[width], im[width];
+
+            for (size_t i = 0; i < count; i += width)
+            {
+                // Partial trailing pack goes through a zero-padded copy
+                size_t m = std::min<size_t>(width, count - i);
+                for (size_t l = 0; l < m; l++) { a[l] = c2[i + l]; b[l] = c1[i + l]; c[l] = c0[i + l]; }
+                for (size_t l = m; l < width; l++) { a[l] = 1.; b[l] = c[l] = 0.; }
+
+                packd pr0, pr1, pim;
+                int linBits, cpxBits, noneBits;
+                quadraticPack(load(a), load(b), load(c), polish, pr0, pr1, pim, linBits, cpxBits, noneBits);
+                store(r0, pr0); store(r1, pr1); store(im, pim);
+
+                for (size_t l = 0; l < m; l++)
+                {
+                    int lin = (linBits >> l) & 1, cpx = (cpxBits >> l) & 1, none = (noneBits >> l) & 1;
+                    int n = lin ? 1 - none : 2 * (1 - cpx);
+                    nroots[i + l] = n;
+                    roots[i + l] = n > 0 ? r0[l] : nan;
+                    roots[count + i + l] = n > 1 ? r1[l] : nan;
+                    if (csolns != NULL)
+                    {
+                        csolns[i + l] = cdouble(r0[l], -im[l]);
+                        csolns[count + i + l] = cdouble(r1[l], im[l]);
+                    }
+                }
+            }
+        }
+
+        void solveCubic(const double *c3, const double *c2, const double *c1, const double *c0, size_t count,
+            int *nroots, double *roots, int polish, cdouble *csolns)
+        {
+            using namespace simd;
+            const double nan = std::numeric_limits<double>::quiet_NaN();
+            const packd zero = set1(0.), third = set1(1. / 3.);
+
+            double P[ROOT_BLOCK], A[ROOT_BLOCK], B[ROOT_BLOCK], D[ROOT_BLOCK], T[ROOT_BLOCK];
+            double X0[ROOT_BLOCK], X1[ROOT_BLOCK], X2[ROOT_BLOCK], IM[ROOT_BLOCK];
+
+            for (size_t i0 = 0; i0 < count; i0 += ROOT_BLOCK)
+            {
+                size_t m = std::min(ROOT_BLOCK, count - i0);
+                size_t mp = (m + width - 1) / width * width;
+
+                // Normalize and depress: x = t - p/3, t^3 + a*t + b = 0
+                for (size_t l = 0; l < mp; l++)
+                {
+                    size_t i = i0 + l;
+                    double lead = l < m ? c3[i] : 1.;
+                    double inv = std::abs(lead) < 1e-6 ? 0. : 1. / lead;
+                    P[l] = l < m ? c2[i] * inv : 0.;
+                    A[l] = l < m ? c1[i] * inv : -1.;
+                    B[l] = l < m ? c0[i] * inv : 0.;
+                }
+                for (size_t l = 0; l < mp; l += width)
+                {
+                    packd p = load(P + l), q = load(A + l), r = load(B + l);
+                    packd a = sub(q, mul(mul(p, p), third));
+                    packd b = mul(fmadd(p, fmadd(set1(2.), mul(p, p), mul(set1(-9.), q)), mul(set1(27.), r)), set1(1. / 27.));
+                    store(A + l, a);
+                    store(B + l, b);
+                    store(D + l, fmadd(mul(b, b), set1(0.25), mul(mul(a, mul(a, a)), set1(1. / 27.))));
+                }
+
+                // One real root per equation, selected without branching: Cardano when D > 0,
+                // otherwise the largest trigonometric root.
+                for (size_t l = 0; l < mp; l++)
+                {
+                    double a = A[l], b = B[l], d = D[l];
+                    double s = std::sqrt(std::max(d, 0.));
+                    double u = std::cbrt(-0.5 * b - std::copysign(s, b));
+                    double tc = u - a / (3. * (u == 0. ? 1. : u));
+                    double as = a < 0. ? a : -1.;
+                    double arg = std::min(1., std::max(-1., (1.5 * b / as) * std::sqrt(-3. / as)));
+                    double tt = 2. * std::sqrt(std::max(-a / 3., 0.)) * std::cos(std::acos(arg) / 3.);
+                    T[l] = d > 0. ? tc : tt;
+                }
+
+                // Deflate (t - t0)(t^2 + t0*t + a + t0^2) and solve the remaining quadratic
+                for (size_t l = 0; l < mp; l += width)
+                {
+                    packd p = load(P + l), a = load(A + l), t0 = load(T + l);
+                    packd shift = mul(p, third);
+
+                    packd q0, q1, qim;
+                    int linBits, cpxBits, noneBits;
+                    quadraticPack(set1(1.), t0, fmadd(t0, t0, a), 0, q0, q1, qim, linBits, cpxBits, noneBits);
+
+                    packd x0 = sub(t0, shift), x1 = sub(q0, shift), x2 = sub(q1, shift);
+                    if (polish > 0)
+                    {
+                        // Newton on the monic cubic x^3 + p*x^2 + q*x + r, keeping only steps
+                        // that reduce |f| (see quadraticPack)
+                        packd q = load(A + l);
+                        q = fmadd(p, mul(p, third), q);
+                        packd r = sub(load(B + l), mul(mul(shift, shift), mul(shift, set1(2.))));
+                        r = add(r, mul(shift, q));
+                        packd xs[3] = { x0, x1, x2 };
+                        for (int k = 0; k < polish; k++)
+                        {
+                            for (int j = 0; j < 3; j++)
+                            {
+                                packd x = xs[j];
+                                packd f = fmadd(fmadd(add(x, p), x, q), x, r);
+                                packd df = fmadd(fmadd(set1(3.), x, add(p, p)), x, q);
+                                packd xn = sub(x, div(f, df));
+                                packd fn = fmadd(fmadd(add(xn, p), xn, q), xn, r);
+                                xs[j] = select(lt(abs(fn), abs(f)), xn, x);
+                            }
+                        }
+                        x0 = xs[0];
+                        x1 = select(lt(zero, qim), x1, xs[1]);
+                        x2 = select(lt(zero, qim), x2, xs[2]);
+                    }
+
+                    store(X0 + l, x0); store(X1 + l, x1); store(X2 + l, x2); store(IM + l, qim);
+                }
+
+                for (size_t l = 0; l < m; l++)
+                {
+                    size_t i = i0 + l;
+                    if (std::abs(c3[i]) < 1e-6)
+                    {
+                        // Degenerate leading coefficient
+                        double rq[2];
+                        cdouble cq[2];
+                        solveQuadratic(c2 + i, c1 + i, c0 + i, 1, nroots + i, rq, polish, cq);
+                        roots[i] = rq[0];
+                        roots[count + i] = rq[1];
+                        roots[2 * count + i] = nan;
+                        if (csolns != NULL)
+                        {
+                            csolns[i] = cq[0];
+                            csolns[count + i] = cq[1];
+                            csolns[2 * count + i] = nan;
+                        }
+                        continue;
+                    }
+
+                    double x0 = X0[l], x1 = X1[l], x2 = X2[l];
+                    // Near-zero imaginary parts are a rounded double root
+                    int real = IM[l] > 1e-7 * std::max(1., std::abs(x1)) ? 0 : 1;
+                    nroots[i] = 1 + 2 * real;
+
+                    // Sort the three roots (x1 <= x2 already)
+                    double lo = std::min(x0, x1), hi = std::max(x0, x2);
+                    double mid = std::max(lo, std::min(std::max(x0, x1), x2));
+                    roots[i] = real ? lo : x0;
+                    roots[count + i] = real ? mid : nan;
+                    roots[2 * count + i] = real ? hi : nan;
+
+                    if (csolns != NULL)
+                    {
+                        double im = real ? 0. : IM[l];
+                        csolns[i] = x0;
+                        csolns[count + i] = cdouble(x1, -im);
+                        csolns[2 * count + i] = cdouble(x2, im);
+                    }
+                }
+            }
+        }
+
         double evalPoly(const double *coeffs, const double x, const int n)
         {
             double res = 0.0;
@@ -100,6 +385,91 @@ namespace mg
             return res;
         }
 
+        // Horner over SIMD lanes, four independent packs per iteration to hide FMA latency.
+        static void evalPolyBatch(const double *coeffs, const double *x, double *y,
+            size_t count, const int n, bool rev)
+        {
+            using namespace simd;
+            const int first = rev ? n : 0;
+            const int step = rev ? -1 : 1;
+
+            size_t i = 0;
+            for (; i + 4 * width <= count; i += 4 * width)
+            {
+                packd x0 = load(x + i), x1 = load(x + i + width);
+                packd x2 = load(x + i + 2 * width), x3 = load(x + i + 3 * width);
+                packd r0 = set1(coeffs[first]), r1 = r0, r2 = r0, r3 = r0;
+                for (int k = 1, j = first + step; k <= n; k++, j += step)
+                {
+                    packd c = set1(coeffs[j]);
+                    r0 = fmadd(r0, x0, c);
+                    r1 = fmadd(r1, x1, c);
+                    r2 = fmadd(r2, x2, c);
+                    r3 = fmadd(r3, x3, c);
+                }
+                store(y + i, r0);
+                store(y + i + width, r1);
+                store(y + i + 2 * width, r2);
+                store(y + i + 3 * width, r3);
+            }
+            for (; i + width <= count; i += width)
+            {
+                packd xi = load(x + i);
+                packd r = set1(coeffs[first]);
+                for (int k = 1, j = first + step; k <= n; k++, j += step)
+                    r = fmadd(r, xi, set1(coeffs[j]));
+                store(y + i, r);
+            }
+            for (; i < count; i++)
+                y[i] = rev ? evalPolyR(coeffs, x[i], n) : evalPoly(coeffs, x[i], n);
+        }
+
+        void evalPoly(const double *coeffs, const double *x, double *y, size_t count, const int n)
+        {
+            evalPolyBatch(coeffs, x, y, count, n, false);
+        }
+
+        void evalPolyR(const double *coeffs, const double *x, double *y, size_t count, const int n)
+        {
+            evalPolyBatch(coeffs, x, y, count, n, true);
+        }
+
+        VecX evalPoly(const double *coeffs, const Eigen::Ref<const VecX> &x, const int n)
+        {
+            VecX y(x.size());
+            evalPolyBatch(coeffs, x.data(), y.data(), x.size(), n, false);
+            return y;
+        }
+
+        VecX evalPolyR(const double *coeffs, const Eigen::Ref<const VecX> &x, const int n)
+        {
+            VecX y(x.size());
+            evalPolyBatch(coeffs, x.data(), y.data(), x.size(), n, true);
+            return y;
+        }
+
+        void evalPolys(const double *coeffs, const double x, double *y, size_t count, const int n)
+        {
+            using namespace simd;
+            const packd xp = set1(x);
+
+            size_t k = 0;
+            for (; k + width <= count; k += width)
+            {
+                packd r = load(coeffs + k);
+                for (int i = 1; i <= n; i++)
+                    r = fmadd(r, xp, load(coeffs + i * count + k));
+                store(y + k, r);
+            }
+            for (; k < count; k++)
+            {
+                double r = coeffs[k];
+                for (int i = 1; i <= n; i++)
+                    r = coeffs[i * count + k] + x * r;
+                y[k] = r;
+            }
+        }
+
         double evalLine1(const double coeffs[3], const double x)
         {
             return (-coeffs[0] * x - coeffs[2]) / coeffs[1];
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "core.h"
+#include "parallel.h"
+#include "simd.h"
 
 #include <stdarg.h>
 
@@ -12,12 +14,96 @@ namespace mg
 
         int solveCubic(double c3, double c2, double c1, double c0, cdouble solns[3]);
 
+        // Solves c4*x^4 + c3*x^3 + c2*x^2 + c1*x + c0 = 0 (Ferrari). Returns the number of real roots.
+        int solveQuartic(double c4, double c3, double c2, double c1, double c0, cdouble solns[4]);
+
+        // Batch solvers over SoA coefficient arrays of length count. nroots[i] receives the number
+        // of real roots of equation i and roots[k * count + i] its k'th real root in ascending
+        // order; unused slots are set to NaN. polish Newton iterations are applied to each root.
+        // If csolns is non-NULL, all roots (complex pairs included) are also stored there root-major.
+        void solveQuadratic(const double *c2, const double *c1, const double *c0, size_t count,
+            int *nroots, double *roots, int polish = 0, cdouble *csolns = NULL);
+
+        void solveCubic(const double *c3, const double *c2, const double *c1, const double *c0, size_t count,
+            int *nroots, double *roots, int polish = 0, cdouble *csolns = NULL);
+
         // Evaluates a polynomial with coefficients a_n...a_0
         double evalPoly(const double *coeffs, const double x, const int n = 2);
 
         // Evaluates a polynomial with coefficients a_0...a_n
         double evalPolyR(const double *coeffs, const double x, const int n = 2);
 
+        // Batched evalPoly/evalPolyR: evaluates the polynomial at each of the count values in x
+        void evalPoly(const double *coeffs, const double *x, double *y, size_t count, const int n = 2);
+        void evalPolyR(const double *coeffs, const double *x, double *y, size_t count, const int n = 2);
+        VecX evalPoly(const double *coeffs, const Eigen::Ref<const VecX> &x, const int n = 2);
+        VecX evalPolyR(const double *coeffs, const Eigen::Ref<const VecX> &x, const int n = 2);
+
+        // Evaluates count polynomials with coefficients a_n...a_0 at a single x.
+        // Coefficients are stored coefficient-major, i.e. coeffs[i * count + k] is a_(n-i) of polynomial k.
+        void evalPolys(const double *coeffs, const double x, double *y, size_t count, const int n = 2);
+
+        namespace detail
+        {
+            // Unrolled Horner step I of a degree N polynomial (R: coefficients stored a_0...a_N)
+            template<int I, int N, bool R>
+            struct horner
+            {
+                static inline double eval(const double *c, double x, double acc)
+                {
+                    return horner<I + 1, N, R>::eval(c, x, acc * x + c[R ? N - I : I]);
+                }
+
+                static inline simd::packd eval_pack(const double *c, simd::packd x, simd::packd acc)
+                {
+                    return horner<I + 1, N, R>::eval_pack(c, x, simd::fmadd(acc, x, simd::set1(c[R ? N - I : I])));
+                }
+            };
+
+            template<int N, bool R>
+            struct horner<N + 1, N, R>
+            {
+                static inline double eval(const double *, double, double acc) { return acc; }
+                static inline simd::packd eval_pack(const double *, simd::packd, simd::packd acc) { return acc; }
+            };
+
+            template<int N, bool R>
+            void evalPolyN(const double *coeffs, const double *x, double *y, size_t count)
+            {
+                const simd::packd c0 = simd::set1(coeffs[R ? N : 0]);
+                size_t i = 0;
+                for (; i + simd::width <= count; i += simd::width)
+                    simd::store(y + i, horner<1, N, R>::eval_pack(coeffs, simd::load(x + i), c0));
+                for (; i < count; i++)
+                    y[i] = horner<1, N, R>::eval(coeffs, x[i], coeffs[R ? N : 0]);
+            }
+        }
+
+        // Compile-time degree variants of evalPoly/evalPolyR; the Horner loop is fully unrolled.
+        template<int N>
+        inline double evalPoly(const double *coeffs, const double x)
+        {
+            return detail::horner<1, N, false>::eval(coeffs, x, coeffs[0]);
+        }
+
+        template<int N>
+        inline double evalPolyR(const double *coeffs, const double x)
+        {
+            return detail::horner<1, N, true>::eval(coeffs, x, coeffs[N]);
+        }
+
+        template<int N>
+        inline void evalPoly(const double *coeffs, const double *x, double *y, size_t count)
+        {
+            detail::evalPolyN<N, false>(coeffs, x, y, count);
+        }
+
+        template<int N>
+        inline void evalPolyR(const double *coeffs, const double *x, double *y, size_t count)
+        {
+            detail::evalPolyN<N, true>(coeffs, x, y, count);
+        }
+
         // Evaluates a line of the form a2 + a1*y + a0*x = 0 at x
         double evalLine1(const double coeffs[3], const double x);
 
@@ -27,6 +113,7 @@ namespace mg
         using fn_rk4 = T(*)(const T&, va_list args);
 
         // Fourth-order Runge-Kutta method for solving the Initial Value Problem
+        // (see ode.h for callable-based fixed-step and adaptive integrators)
         template<typename T>
         T rk4(fn_rk4<T> f, const T y0, double t, int steps, ...)
         {
@@ -36,10 +123,10 @@ namespace mg
             va_list args;
             va_start(args, steps);
             for (int i = 0; i < steps; i++) {
-                k1 = f(y0, args);
-                k2 = f(y0 + (h / 2)*k1, args);
-                k3 = f(y0 + (h / 2)*k2, args);
-                k4 = f(y0 + h * k3, args);
+                k1 = f(yn, args);
+                k2 = f(yn + (h / 2)*k1, args);
+                k3 = f(yn + (h / 2)*k2, args);
+                k4 = f(yn + h * k3, args);
                 yn += (h / 6)*(k1 + 2 * k2 + 2 * k3 + k4);
             }
             va_end(args);
@@ -67,7 +154,7 @@ namespace mg
         // Mean function
         // TODO: merge linear functions
         template<typename Derived>
-        Derived mean(const EigList<Derived> &X, double *W = NULL)
+        Derived mean(const EigList<Derived> &X, const double *W = NULL)
         {
             size_t num_obs = X.size();
             Derived xbar;
@@ -89,7 +176,7 @@ namespace mg
             return xbar;
         }
         template<typename Key, typename Derived>
-        Derived mean(const EigMap<Key, Derived> &X, double *W = NULL)
+        Derived mean(const EigMap<Key, Derived> &X, const double *W = NULL)
         {
             size_t num_obs = X.size();
             Derived xbar;
@@ -112,6 +199,65 @@ namespace mg
             return xbar;
         }
 
+        // Index of the element of X with the smallest component index (the first if tied).
+        // Vectorized with strided loads when the vectors are stored contiguously.
+        template<typename Derived>
+        size_t argmin(const EigList<Derived> &X, int index)
+        {
+            size_t num_obs = X.size(), i = 0, imin = 0;
+            if (num_obs == 0)
+                return 0;
+
+            const int stride = (int)(sizeof(Derived) / sizeof(double));
+            const bool contiguous = Derived::SizeAtCompileTime != Eigen::Dynamic &&
+                std::is_same<typename Derived::Scalar, double>::value &&
+                sizeof(Derived) == stride * sizeof(double);
+
+            double vmin = X[0](index);
+            if (contiguous && num_obs >= (size_t)simd::width)
+            {
+                const double *base = &X[0](index);
+
+                double lanes[simd::width];
+                for (int k = 0; k < simd::width; k++)
+                    lanes[k] = k;
+
+                // Per-lane minimum and its index, every lane seeded with element 0 as the scalar
+                // loop is (so a NaN only hides itself); strict < keeps each lane's first occurrence
+                simd::packd best = simd::set1(vmin), bestIdx = simd::set1(0.);
+                simd::packd idx = simd::load(lanes), step = simd::set1((double)simd::width);
+                for (i = 0; i + simd::width <= num_obs; i += simd::width)
+                {
+                    simd::packd v = simd::loadStrided(base + i * stride, stride);
+                    simd::maskd m = simd::lt(v, best);
+                    best = simd::select(m, v, best);
+                    bestIdx = simd::select(m, idx, bestIdx);
+                    idx = simd::add(idx, step);
+                }
+
+                double bv[simd::width], bi[simd::width];
+                simd::store(bv, best);
+                simd::store(bi, bestIdx);
+                vmin = bv[0];
+                imin = (size_t)bi[0];
+                for (int k = 1; k < simd::width; k++) {
+                    if (bv[k] < vmin || (bv[k] == vmin && (size_t)bi[k] < imin)) {
+                        vmin = bv[k];
+                        imin = (size_t)bi[k];
+                    }
+                }
+            }
+
+            for (; i < num_obs; i++) {
+                if (X[i](index) < vmin) {
+                    vmin = X[i](index);
+                    imin = i;
+                }
+            }
+
+            return imin;
+        }
+
         template<typename Derived>
         Derived min(const EigList<Derived> &X, int index, int &minIndex)
         {
@@ -120,21 +266,15 @@ namespace mg
 
             if (num_obs > 0)
             {
-                xmin = X[0];
-                minIndex = 0;
-
-                for (int i = 1; i < num_obs; i++)
-                    if (X[i](index) < xmin(index))
-                    {
-                        xmin = X[i];
-                        minIndex = i;
-                    }
+                minIndex = (int)argmin(X, index);
+                xmin = X[minIndex];
             }
 
             return xmin;
         }
 
-        // Covariance function
+        // Covariance function (see moments.h for a streaming, mergeable accumulator).
+        // Uses *xbar as the mean if given, otherwise the (weighted) mean of X.
         template<typename vDerived>
         MatrixXX cov(const EigList<vDerived>& X,
             Eigen::MatrixBase<vDerived> *xbar = NULL,
@@ -145,18 +285,16 @@ namespace mg
 
             if (num_obs > 0)
             {
-                P = mg::MatrixXX::Zero(xbar->rows(), xbar->rows());
-
-                if (xbar == NULL)
-                    *xbar = mean(X);
+                vDerived mu = xbar != NULL ? xbar->derived() : mean(X, W);
+                P = mg::MatrixXX::Zero(mu.rows(), mu.rows());
 
                 for (int i = 0; i < num_obs; i++)
                 {
-                    VecX xvar = X[i] - *xbar;
+                    vDerived xvar = X[i] - mu;
                     if (W != NULL)
-                        P += W[i] * xvar * xvar.transpose();
+                        P.noalias() += W[i] * xvar * xvar.transpose();
                     else
-                        P += xvar * xvar.transpose();
+                        P.noalias() += xvar * xvar.transpose();
                 }
 
                 if (W == NULL)
@@ -166,6 +304,173 @@ namespace mg
             return P;
         }
 
+        // Fused single pass mean and covariance of fixed-size vectors, with no heap allocation.
+        // Sums are shifted by the first sample to limit cancellation. Weights are assumed
+        // normalized, as in mean and cov.
+        template<int N>
+        void meanCov(const EigList<Vec<double, N> >& X, Vec<double, N> &xbar, Mat<double, N, N> &P,
+            const double *W = NULL)
+        {
+            size_t num_obs = X.size();
+            xbar.setZero();
+            P.setZero();
+            if (num_obs == 0)
+                return;
+
+            const Vec<double, N> x0 = X[0];
+            Vec<double, N> s = Vec<double, N>::Zero();
+            double sw = 0;
+            for (size_t i = 0; i < num_obs; i++)
+            {
+                Vec<double, N> xs = X[i] - x0;
+                double w = W != NULL ? W[i] : 1.;
+                sw += w;
+                s += w * xs;
+                P.noalias() += (w * xs) * xs.transpose();
+            }
+
+            if (sw <= 0)
+                return;
+
+            xbar = x0 + s / sw;
+            P.noalias() -= s * s.transpose() / sw;
+            if (W == NULL)
+                P /= double(num_obs);
+        }
+
+        // Fixed-size covariance, returning Mat<double,N,N> without heap allocation
+        template<int N>
+        typename std::enable_if<(N > 0), Mat<double, N, N> >::type cov(const EigList<Vec<double, N> >& X,
+            const Vec<double, N> *xbar = NULL,
+            const double *W = NULL)
+        {
+            Vec<double, N> mu;
+            Mat<double, N, N> P;
+            meanCov(X, mu, P, W);
+            if (xbar == NULL || X.empty())
+                return P;
+
+            // About the given mean instead
+            double sw = (double)X.size();
+            if (W != NULL) {
+                sw = 0;
+                for (size_t i = 0; i < X.size(); i++)
+                    sw += W[i];
+            }
+            Vec<double, N> delta = mu - *xbar;
+            P.noalias() += (W != NULL ? sw : 1.) * delta * delta.transpose();
+            return P;
+        }
+
+        // Covariance of large sample sets, normalized by the total weight (equal to cov for
+        // unit or normalized weights). Samples are processed in blocks of block columns spread
+        // over threads: each block is centred on its own mean into a column-major buffer (read
+        // through an Eigen::Map when the vectors are stored contiguously) and its scatter matrix
+        // computed by a GEMM. Blocks are combined in order with Chan's update, so the result
+        // doesn't depend on threads. Returns a fixed-size matrix for fixed-size vectors.
+        template<typename vDerived>
+        Mat<double, vDerived::RowsAtCompileTime, vDerived::RowsAtCompileTime> covBlocked(
+            const EigList<vDerived>& X,
+            const Vec<double, vDerived::RowsAtCompileTime> *xbar = NULL,
+            const double *W = NULL,
+            int threads = 0,
+            size_t block = 8192)
+        {
+            enum { N = vDerived::RowsAtCompileTime };
+            typedef Mat<double, N, N> Matrix;
+            typedef Mat<double, N, 1> Vector;
+            typedef Mat<double, N, Eigen::Dynamic> Block;
+
+            size_t num_obs = X.size();
+            int d = num_obs > 0 ? (int)X[0].rows() : (N > 0 ? N : 0);
+            Matrix P = Matrix::Zero(d, d);
+            if (num_obs == 0)
+                return P;
+
+            const bool contiguous = N != Eigen::Dynamic && sizeof(vDerived) == N * sizeof(double);
+
+            block = std::max<size_t>(block, 1);
+            size_t nb = (num_obs + block - 1) / block;
+            std::vector<double> bw(nb);
+            EigList<Vector> bmu(nb, Vector::Zero(d));
+            EigList<Matrix> bM2(nb, Matrix::Zero(d, d));
+
+            threads = parallel::threadCount(threads);
+            std::vector<Block> buf(threads), wbuf(threads);
+
+            parallel::forChunks(nb, threads, 1, [&](size_t b0, size_t b1, int k) {
+                Block &B = buf[k], &BW = wbuf[k];
+                for (size_t b = b0; b < b1; b++)
+                {
+                    size_t i0 = b * block, m = std::min(block, num_obs - i0);
+                    Vector &mu = bmu[b];
+                    B.resize(d, m);
+
+                    double wsum = (double)m;
+                    if (W != NULL)
+                    {
+                        wsum = 0;
+                        mu.setZero();
+                        for (size_t j = 0; j < m; j++) {
+                            wsum += W[i0 + j];
+                            mu += W[i0 + j] * X[i0 + j];
+                        }
+                        if (wsum > 0)
+                            mu /= wsum;
+                    }
+                    else if (contiguous)
+                        mu = Eigen::Map<const Block>(X[i0].data(), d, m).rowwise().sum() / wsum;
+                    else
+                    {
+                        mu.setZero();
+                        for (size_t j = 0; j < m; j++)
+                            mu += X[i0 + j];
+                        mu /= wsum;
+                    }
+
+                    if (contiguous)
+                        B.noalias() = Eigen::Map<const Block>(X[i0].data(), d, m).colwise() - mu;
+                    else
+                        for (size_t j = 0; j < m; j++)
+                            B.col(j) = X[i0 + j] - mu;
+
+                    if (W != NULL) {
+                        BW.noalias() = B * Eigen::Map<const VecX>(W + i0, m).asDiagonal();
+                        bM2[b].noalias() = BW * B.transpose();
+                    }
+                    else
+                        bM2[b].noalias() = B * B.transpose();
+                    bw[b] = wsum;
+                }
+            });
+
+            // Combine blocks in order
+            double wt = 0;
+            Vector mu = Vector::Zero(d);
+            for (size_t b = 0; b < nb; b++)
+            {
+                if (bw[b] <= 0)
+                    continue;
+
+                double wn = wt + bw[b];
+                Vector delta = bmu[b] - mu;
+                mu += (bw[b] / wn) * delta;
+                P += bM2[b] + (wt * bw[b] / wn) * delta * delta.transpose();
+                wt = wn;
+            }
+
+            if (wt <= 0)
+                return Matrix::Zero(d, d);
+
+            // About a given mean instead
+            if (xbar != NULL) {
+                Vector delta = mu - *xbar;
+                P += wt * delta * delta.transpose();
+            }
+
+            return P / wt;
+        }
+
         template<typename vDerived1, typename vDerived2>
         MatrixXX cov(const EigList<vDerived1>& X, const EigList<vDerived2>& Y,
             Eigen::MatrixBase<vDerived1> *xbar = NULL,
@@ -177,19 +482,18 @@ namespace mg
 
             if (num_obs > 0)
             {
-                P = mg::MatrixXX::Zero(xbar->rows(), ybar->rows());
-
-                if (xbar == NULL) *xbar = mean(X);
-                if (ybar == NULL) *ybar = mean(Y);
+                vDerived1 mux = xbar != NULL ? xbar->derived() : mean(X, W);
+                vDerived2 muy = ybar != NULL ? ybar->derived() : mean(Y, W);
+                P = mg::MatrixXX::Zero(mux.rows(), muy.rows());
 
                 for (int i = 0; i < X.size(); i++)
                 {
-                    VecX xvar = X[i] - *xbar;
-                    VecX yvar = Y[i] - *ybar;
+                    vDerived1 xvar = X[i] - mux;
+                    vDerived2 yvar = Y[i] - muy;
                     if (W != NULL)
-                        P += W[i] * xvar * yvar.transpose();
+                        P.noalias() += W[i] * xvar * yvar.transpose();
                     else
-                        P += xvar * yvar.transpose();
+                        P.noalias() += xvar * yvar.transpose();
                 }
 
                 if (W == NULL)
@@ -0,0 +1,125 @@
+#include "arena.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace mg
+{
+    arena::arena(size_t blockSize) :
+        blockSize(std::max<size_t>(blockSize, 256)), cur(0), ptr(NULL), end(NULL)
+    {
+    }
+
+    arena::~arena()
+    {
+        clear();
+    }
+
+    void* arena::allocate(size_t bytes, size_t align)
+    {
+        uintptr_t p = ((uintptr_t)ptr + align - 1) & ~(uintptr_t)(align - 1);
+        if (ptr == NULL || p + bytes > (uintptr_t)end)
+        {
+            // Next kept block that fits, or a new one at least twice the size of the last
+            size_t need = bytes + align;
+            size_t next = ptr == NULL ? 0 : cur + 1;
+            while (next < blocks.size() && blocks[next].size < need)
+                next++;
+
+            if (next == blocks.size()) {
+                size_t size = blocks.empty() ? blockSize : blocks.back().size * 2;
+                block b = { static_cast<char*>(std::malloc(std::max(size, need))), std::max(size, need) };
+                if (b.data == NULL)
+                    throw std::bad_alloc();
+                blocks.push_back(b);
+            }
+
+            cur = next;
+            ptr = blocks[cur].data;
+            end = ptr + blocks[cur].size;
+            p = ((uintptr_t)ptr + align - 1) & ~(uintptr_t)(align - 1);
+        }
+
+        ptr = (char*)(p + bytes);
+        return (void*)p;
+    }
+
+    void arena::release()
+    {
+        cur = 0;
+        ptr = blocks.empty() ? NULL : blocks[0].data;
+        end = blocks.empty() ? NULL : blocks[0].data + blocks[0].size;
+    }
+
+    void arena::clear()
+    {
+        for (block &b : blocks)
+            std::free(b.data);
+        blocks.clear();
+        cur = 0;
+        ptr = end = NULL;
+    }
+
+    size_t arena::capacity() const
+    {
+        size_t n = 0;
+        for (const block &b : blocks)
+            n += b.size;
+        return n;
+    }
+
+    node_pool::node_pool(size_t blockSize) : mem(blockSize)
+    {
+        std::memset(heads, 0, sizeof heads);
+    }
+
+    node_pool::~node_pool()
+    {
+    }
+
+    void* node_pool::allocate(size_t bytes, size_t align)
+    {
+        size_t size;
+        void **h = head(bytes, align, size);
+        if (h == NULL)
+            return mem.allocate(bytes, align);
+
+        if (*h != NULL) {
+            void *p = *h;
+            *h = *static_cast<void**>(p);
+            return p;
+        }
+
+        return mem.allocate(size, std::max(align, (size_t)granularity));
+    }
+
+    void node_pool::deallocate(void *p, size_t bytes, size_t align)
+    {
+        size_t size;
+        void **h = head(bytes, align, size);
+        if (h == NULL || p == NULL)
+            return;
+
+        *static_cast<void**>(p) = *h;
+        *h = p;
+    }
+
+    void node_pool::release()
+    {
+        mem.release();
+        std::memset(heads, 0, sizeof heads);
+    }
+
+    void** node_pool::head(size_t bytes, size_t align, size_t &size)
+    {
+        size_t c = (std::max(bytes, sizeof(void*)) + granularity - 1) / granularity;
+        if (c > classes || align > 64)
+            return NULL;
+
+        size = c * granularity;
+        size_t a = align <= 16 ? 0 : align <= 32 ? 1 : 2;
+        return &heads[a][c - 1];
+    }
+}
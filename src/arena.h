@@ -0,0 +1,191 @@
+#pragma once
+
+#include "core.h"
+
+#include <cstddef>
+
+namespace mg
+{
+    // Monotonic allocator over a list of blocks. Allocation bumps a pointer; nothing is freed
+    // individually. release() rewinds to the first block in O(1) and keeps the blocks for
+    // reuse, so per-frame scratch containers cost no mallocs once the arena has warmed up.
+    class arena
+    {
+    public:
+        explicit arena(size_t blockSize = 64 * 1024);
+        ~arena();
+
+        arena(const arena&) = delete;
+        arena& operator=(const arena&) = delete;
+
+        void* allocate(size_t bytes, size_t align = alignof(std::max_align_t));
+
+        // Invalidates everything allocated so far
+        void release();
+
+        // Releases and frees all blocks
+        void clear();
+
+        // Total bytes held in blocks
+        size_t capacity() const;
+
+    private:
+        struct block
+        {
+            char *data;
+            size_t size;
+        };
+
+        size_t blockSize;
+        std::vector<block> blocks;
+        size_t cur;
+        char *ptr, *end;
+    };
+
+    // Fixed-size block pool for node-based containers. Blocks are carved from an arena and
+    // recycled through free lists per size (16 byte classes up to 512 bytes) and alignment.
+    // Larger or over-aligned requests go to the arena directly. release() is O(1).
+    class node_pool
+    {
+    public:
+        explicit node_pool(size_t blockSize = 64 * 1024);
+        ~node_pool();
+
+        node_pool(const node_pool&) = delete;
+        node_pool& operator=(const node_pool&) = delete;
+
+        void* allocate(size_t bytes, size_t align);
+        void deallocate(void *p, size_t bytes, size_t align);
+
+        // Invalidates everything allocated so far
+        void release();
+
+    private:
+        static const size_t granularity = 16;
+        static const size_t classes = 32;
+        static const size_t alignments = 3; // 16, 32, 64
+
+        arena mem;
+        void *heads[alignments][classes];
+
+        // Free list for a request, NULL if it isn't pooled
+        void** head(size_t bytes, size_t align, size_t &size);
+    };
+
+    // Allocator over an arena. deallocate() is a no-op; memory comes back on arena::release().
+    template <typename T>
+    class arena_allocator
+    {
+    public:
+        typedef T value_type;
+
+        template <typename U>
+        struct rebind { typedef arena_allocator<U> other; };
+
+        arena_allocator(arena &a) noexcept : a(&a) {}
+        template <typename U>
+        arena_allocator(const arena_allocator<U> &o) noexcept : a(o.a) {}
+
+        T* allocate(size_t n) { return static_cast<T*>(a->allocate(n * sizeof(T), alignof(T))); }
+        void deallocate(T*, size_t) noexcept {}
+
+        arena *a;
+    };
+
+    template <typename T, typename U>
+    bool operator==(const arena_allocator<T> &x, const arena_allocator<U> &y) { return x.a == y.a; }
+    template <typename T, typename U>
+    bool operator!=(const arena_allocator<T> &x, const arena_allocator<U> &y) { return x.a != y.a; }
+
+    // Allocator over a node_pool. Freed nodes are reused by later allocations of the same size.
+    template <typename T>
+    class pool_allocator
+    {
+    public:
+        typedef T value_type;
+
+        template <typename U>
+        struct rebind { typedef pool_allocator<U> other; };
+
+        pool_allocator(node_pool &p) noexcept : p(&p) {}
+        template <typename U>
+        pool_allocator(const pool_allocator<U> &o) noexcept : p(o.p) {}
+
+        T* allocate(size_t n) { return static_cast<T*>(p->allocate(n * sizeof(T), alignof(T))); }
+        void deallocate(T *q, size_t n) noexcept { p->deallocate(q, n * sizeof(T), alignof(T)); }
+
+        node_pool *p;
+    };
+
+    template <typename T, typename U>
+    bool operator==(const pool_allocator<T> &x, const pool_allocator<U> &y) { return x.p == y.p; }
+    template <typename T, typename U>
+    bool operator!=(const pool_allocator<T> &x, const pool_allocator<U> &y) { return x.p != y.p; }
+
+    /**
+     * Arena (monotonic) and Pool (recycling) variants of the container aliases. Containers
+     * take the allocator on construction, e.g. ArenaEigMap<int, Vec3> m{arena_allocator<int>(a)}.
+     **/
+    template<typename Derived>
+        using ArenaEigList = EigList<Derived, arena_allocator<Derived> >;
+
+    template<
+        typename Derived,
+        typename _hash = Eig_hash<Derived>,
+        typename _equals = std::equal_to<Derived>
+    >
+        using ArenaEigSet = EigSet<Derived, _hash, _equals, arena_allocator<Derived> >;
+
+    template<
+        typename T,
+        int N,
+        int M = 1,
+        typename _cmpr = std::less<Eigen::Matrix<T, N, M> >
+    >
+        using ArenaEigOrdSet = EigOrdSet<T, N, M, _cmpr, arena_allocator<Eigen::Matrix<T, N, M> > >;
+
+    template<
+        typename KT,
+        typename VT,
+        typename _hash = std::hash<KT>,
+        typename _equals = std::equal_to<KT>
+    >
+        using ArenaEigMap = EigMap<KT, VT, _hash, _equals, arena_allocator<std::pair<const KT, VT> > >;
+
+    template<
+        typename KT,
+        typename VT,
+        typename _cmpr = std::less<KT>
+    >
+        using ArenaEigOrdMap = EigOrdMap<KT, VT, _cmpr, arena_allocator<std::pair<const KT, VT> > >;
+
+    template<
+        typename Derived,
+        typename _hash = Eig_hash<Derived>,
+        typename _equals = std::equal_to<Derived>
+    >
+        using PoolEigSet = EigSet<Derived, _hash, _equals, pool_allocator<Derived> >;
+
+    template<
+        typename T,
+        int N,
+        int M = 1,
+        typename _cmpr = std::less<Eigen::Matrix<T, N, M> >
+    >
+        using PoolEigOrdSet = EigOrdSet<T, N, M, _cmpr, pool_allocator<Eigen::Matrix<T, N, M> > >;
+
+    template<
+        typename KT,
+        typename VT,
+        typename _hash = std::hash<KT>,
+        typename _equals = std::equal_to<KT>
+    >
+        using PoolEigMap = EigMap<KT, VT, _hash, _equals, pool_allocator<std::pair<const KT, VT> > >;
+
+    template<
+        typename KT,
+        typename VT,
+        typename _cmpr = std::less<KT>
+    >
+        using PoolEigOrdMap = EigOrdMap<KT, VT, _cmpr, pool_allocator<std::pair<const KT, VT> > >;
+}
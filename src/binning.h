@@ -3,12 +3,17 @@
 #include <vector>
 #include <unordered_set>
 #include <functional>
+#include <algorithm>
 
 #include "core.h"
+#include "parallel.h"
 
 namespace mg
 {
     // Class for sorting elements into bins according to a thresholding function.
+    // Storage is contiguous: inserted values in one list, memberships in another (each bin's
+    // chained in insertion order), and per-bin sum, count and centroid lists. Centroids are
+    // kept up to date on insert, so the summing function only runs on the bins that change.
     template <
         typename T,
         typename LT = std::vector<T>,
@@ -20,9 +25,9 @@ namespace mg
         typedef std::function<bool(T&, T&)> ThreshFunctor;
         typedef std::function<T(ST&)> SumFunctor;
 
-        inline  binning() {}
+        inline  binning() : dirty(false) {}
         inline binning(ThreshFunctor f_thresh_, SumFunctor f_sum_ = nullptr)
-            : f_thresh(f_thresh_), f_sum(f_sum_)
+            : f_thresh(f_thresh_), f_sum(f_sum_), dirty(false)
         {}
         inline ~binning() {}
 
@@ -38,25 +43,22 @@ namespace mg
         //     binning.insert(Vec3f());
         // auto& bins = binning.get_bins();
         // </c>
-        inline void binning::insert(T val, bool bin_multiple = false)
+        inline void insert(T val, bool bin_multiple = false)
         {
-            bool added = false;
+            int v = (int)vals.size();
+            vals.push_back(val);
 
             // find bin that the val belongs in
-            for (int i = 0; i < bins.size(); i++)
+            bool added = false;
+            for (int i = 0; i < (int)counts.size(); i++)
             {
-                ST& bin = bins[i];
-
-                T bin_cen;
-                if (f_sum == nullptr)
-                    bin_cen = sums[i] / bin.size();
-                else
-                    bin_cen = f_sum(bin);
-
+                T bin_cen = cens[i];
                 if (f_thresh(val, bin_cen))
                 {
-                    bin.insert(val);
+                    link(i, v);
                     sums[i] = sums[i] + val;
+                    counts[i]++;
+                    update(i);
                     added = true;
                     if (!bin_multiple) break;
                 }
@@ -65,18 +67,458 @@ namespace mg
             // create new bin
             if (!added)
             {
-                bins.push_back(ST({ val }));
-                sums.push_back(val);
+                int i = newBin(val, 1);
+                link(i, v);
+                update(i);
+            }
+            dirty = true;
+        }
+
+        // Bins the values of the random access range [first, last) in partitions of chunk
+        // values on worker threads, each into its own binning with copies of the threshold and
+        // summing functions, then merges the partitions in order. The result only depends on
+        // the input and chunk (not on threads), but may differ from inserting the values one
+        // at a time.
+        template <typename It>
+        void insert_range(It first, It last, int threads = 0, bool bin_multiple = false, size_t chunk = 4096)
+        {
+            size_t n = (size_t)(last - first);
+            chunk = std::max<size_t>(chunk, 1);
+            size_t parts = (n + chunk - 1) / chunk;
+
+            std::vector<binning> local(parts, binning(f_thresh, f_sum));
+            parallel::forChunks(parts, threads, 1, [&](size_t begin, size_t end, int) {
+                for (size_t p = begin; p < end; p++) {
+                    It it = first + p * chunk, stop = first + std::min((p + 1) * chunk, n);
+                    for (; it != stop; ++it)
+                        local[p].insert(*it, bin_multiple);
+                }
+            });
+
+            for (size_t p = 0; p < parts; p++)
+                merge(local[p]);
+        }
+
+        // Appends other's values and merges each of its bins, in order, into the oldest bin
+        // whose centroid passes the threshold against its centroid, or adds it as a new bin.
+        void merge(const binning &other)
+        {
+            int base = (int)vals.size();
+            vals.insert(vals.end(), other.vals.begin(), other.vals.end());
+
+            for (size_t b = 0; b < other.size(); b++)
+            {
+                T other_cen = other.cens[b];
+                int i = -1;
+                for (int j = 0; j < (int)counts.size() && i < 0; j++)
+                {
+                    T bin_cen = cens[j];
+                    if (f_thresh(other_cen, bin_cen))
+                        i = j;
+                }
+
+                if (i < 0)
+                    i = newBin(other.sums[b], other.counts[b]);
+                else {
+                    sums[i] = sums[i] + other.sums[b];
+                    counts[i] += other.counts[b];
+                }
+
+                for (int k = other.head[b]; k >= 0; k = other.entries[k].next)
+                    link(i, base + other.entries[k].value);
+                update(i);
+            }
+            dirty = true;
+        }
+
+        void clear()
+        {
+            vals.clear();
+            entries.clear();
+            head.clear();
+            tail.clear();
+            sums.clear();
+            counts.clear();
+            cens.clear();
+            bins.clear();
+            dirty = false;
+        }
+
+        size_t size() const { return counts.size(); }
+
+        // All inserted values, in insertion order
+        const LT& values() const { return vals; }
+
+        // Members of bin b
+        ST get_bin(int b) const
+        {
+            ST bin;
+            gather(b, bin);
+            return bin;
+        }
+
+        // Members of every bin, gathered from the contiguous storage on demand. Read only, and
+        // only valid until the next insert or merge.
+        const std::vector<ST>& get_bins()
+        {
+            if (dirty) {
+                bins.resize(size());
+                for (size_t b = 0; b < size(); b++)
+                    gather((int)b, bins[b]);
+                dirty = false;
             }
+            return bins;
         }
 
-        std::vector<ST>& get_bins() { return bins; }
-        LT& get_sums() { return sums; }
+        const LT& get_sums() const { return sums; }
+        const std::vector<size_t>& get_counts() const { return counts; }
+        const LT& get_centroids() const { return cens; }
 
     private:
-        std::vector<ST> bins;
+        struct entry
+        {
+            int value;
+            int next;   // next entry of the same bin, -1 at the end
+        };
+
+        LT vals;
+        std::vector<entry> entries;
+        std::vector<int> head, tail;
         LT sums;
+        std::vector<size_t> counts;
+        LT cens;
         ThreshFunctor f_thresh;
         SumFunctor f_sum;
+
+        // Bins handed out by get_bins, rebuilt after inserts
+        bool dirty;
+        std::vector<ST> bins;
+        ST scratch;
+
+        int newBin(const T &sum, size_t count)
+        {
+            int i = (int)counts.size();
+            sums.push_back(sum);
+            counts.push_back(count);
+            cens.push_back(sum);
+            head.push_back(-1);
+            tail.push_back(-1);
+            return i;
+        }
+
+        void link(int i, int v)
+        {
+            int e = (int)entries.size();
+            entries.push_back(entry{ v, -1 });
+            if (tail[i] < 0)
+                head[i] = e;
+            else
+                entries[tail[i]].next = e;
+            tail[i] = e;
+        }
+
+        void gather(int i, ST &bin) const
+        {
+            bin.clear();
+            for (int k = head[i]; k >= 0; k = entries[k].next)
+                bin.insert(vals[entries[k].value]);
+        }
+
+        void update(int i)
+        {
+            if (f_sum == nullptr)
+                cens[i] = sums[i] / counts[i];
+            else {
+                gather(i, scratch);
+                cens[i] = f_sum(scratch);
+            }
+        }
+    };
+
+    /**
+     * Threshold and sum policies for grid_binning
+     **/
+
+    // Accepts values within half[i] of the centroid along every dimension.
+    // reach() bounds the per-dimension distance any accepted value can have.
+    template <typename T>
+    struct box_thresh
+    {
+        T half;
+
+        box_thresh(const T &half) : half(half) {}
+
+        bool operator()(const T &val, const T &cen) const { return ((val - cen).cwiseAbs().array() < half.array()).all(); }
+        const T &reach() const { return half; }
+    };
+
+    // Accepts values within radius r of the centroid
+    template <typename T>
+    struct radius_thresh
+    {
+        double r;
+        T ext;
+
+        radius_thresh(double r) : r(r), ext(T::Constant(r)) {}
+
+        bool operator()(const T &val, const T &cen) const { return (val - cen).squaredNorm() < r * r; }
+        const T &reach() const { return ext; }
+    };
+
+    // Running sum of a bin's values, with the mean as its centroid. merge() combines the sums
+    // of two bins.
+    template <typename T>
+    struct mean_sum
+    {
+        void add(T &sum, const T &val) const { sum += val; }
+        void merge(T &sum, const T &other) const { sum += other; }
+        T centroid(const T &sum, size_t count) const { return sum / (double)count; }
+    };
+
+    // Binning of fixed-size vector values (Vec<double,N>) with the same semantics as
+    // binning::insert, but bin centroids are indexed by a uniform grid whose cells are the
+    // threshold's reach, so an insert only tests the bins in the 3^N cells around the value.
+    // Centroids are updated incrementally and the policies are resolved at compile time.
+    // Storage is contiguous: inserted values in one array, (bin, value) memberships in
+    // another, and per-bin sum, count and centroid arrays.
+    template <
+        typename T,
+        typename Thresh = box_thresh<T>,
+        typename Sum = mean_sum<T>
+    >
+    class grid_binning
+    {
+    public:
+        enum { N = T::RowsAtCompileTime };
+        typedef Eigen::Matrix<int, N, 1> Cell;
+
+        grid_binning(const Thresh &thresh, const Sum &sum = Sum())
+            : thresh(thresh), sum(sum), cellSize(thresh.reach()), dirty(false)
+        {}
+        ~grid_binning() {}
+
+        // Adds val to the oldest bin whose centroid passes the threshold (every such bin if
+        // bin_multiple is true), or starts a new bin.
+        void insert(const T &val, bool bin_multiple = false)
+        {
+            int v = (int)vals.size();
+            vals.push_back(val);
+
+            candidates(val);
+            bool added = false;
+            for (int i : cand)
+            {
+                if (thresh(val, cens[i]))
+                {
+                    entries.push_back(entry{ i, v });
+                    sum.add(sums[i], val);
+                    counts[i]++;
+                    update(i);
+                    added = true;
+                    if (!bin_multiple) break;
+                }
+            }
+
+            if (!added)
+                entries.push_back(entry{ newBin(val, 1), v });
+            dirty = true;
+        }
+
+        // Bins the values of the random access range [first, last) in partitions of chunk
+        // values on worker threads, each into its own grid_binning, then merges the partitions
+        // in order. The result only depends on the input and chunk (not on threads), but may
+        // differ from inserting the values one at a time.
+        template <typename It>
+        void insert_range(It first, It last, int threads = 0, bool bin_multiple = false, size_t chunk = 4096)
+        {
+            size_t n = (size_t)(last - first);
+            chunk = std::max<size_t>(chunk, 1);
+            size_t parts = (n + chunk - 1) / chunk;
+
+            std::vector<grid_binning> local(parts, grid_binning(thresh, sum));
+            parallel::forChunks(parts, threads, 1, [&](size_t begin, size_t end, int) {
+                for (size_t p = begin; p < end; p++) {
+                    It it = first + p * chunk, stop = first + std::min((p + 1) * chunk, n);
+                    for (; it != stop; ++it)
+                        local[p].insert(*it, bin_multiple);
+                }
+            });
+
+            for (size_t p = 0; p < parts; p++)
+                merge(local[p]);
+        }
+
+        // Appends other's values and merges each of its bins, in order, into the oldest bin
+        // whose centroid passes the threshold against its centroid, or adds it as a new bin.
+        void merge(const grid_binning &other)
+        {
+            int base = (int)vals.size();
+            vals.insert(vals.end(), other.vals.begin(), other.vals.end());
+
+            std::vector<int> to(other.size());
+            for (size_t b = 0; b < other.size(); b++)
+            {
+                int i = match(other.cens[b]);
+                if (i < 0)
+                    i = newBin(other.sums[b], other.counts[b]);
+                else {
+                    sum.merge(sums[i], other.sums[b]);
+                    counts[i] += other.counts[b];
+                    update(i);
+                }
+                to[b] = i;
+            }
+
+            for (const entry &e : other.entries)
+                entries.push_back(entry{ to[e.bin], base + e.value });
+            dirty = true;
+        }
+
+        void clear()
+        {
+            vals.clear();
+            entries.clear();
+            sums.clear();
+            counts.clear();
+            cens.clear();
+            cells_.clear();
+            grid.clear();
+            dirty = true;
+        }
+
+        size_t size() const { return counts.size(); }
+
+        // All inserted values, in insertion order
+        const EigList<T>& values() const { return vals; }
+
+        // Bin b's members as indices into values(), in insertion order, are
+        // members()[offsets()[b]] .. members()[offsets()[b + 1] - 1]
+        const std::vector<int>& offsets() { build(); return offs; }
+        const std::vector<int>& members() { build(); return mems; }
+
+        EigList<T> get_bin(int b)
+        {
+            build();
+            EigList<T> bin;
+            for (int k = offs[b]; k < offs[b + 1]; k++)
+                bin.push_back(vals[mems[k]]);
+            return bin;
+        }
+
+        const EigList<T>& get_sums() const { return sums; }
+        const std::vector<size_t>& get_counts() const { return counts; }
+        const EigList<T>& get_centroids() const { return cens; }
+
+    private:
+        struct entry
+        {
+            int bin;
+            int value;
+        };
+
+        Thresh thresh;
+        Sum sum;
+        T cellSize;
+
+        EigList<T> vals;
+        std::vector<entry> entries;
+        EigList<T> sums;
+        std::vector<size_t> counts;
+        EigList<T> cens;
+        EigList<Cell> cells_;   // grid cell of each centroid
+        EigMap<Cell, std::vector<int>, Vec_hash<int, N> > grid;
+        std::vector<int> cand;
+
+        // Bin members grouped by bin, built from entries on demand
+        bool dirty;
+        std::vector<int> offs, mems;
+
+        Cell cell(const T &x) const
+        {
+            Cell c;
+            for (int d = 0; d < N; d++)
+                c[d] = (int)std::floor(x[d] / cellSize[d]);
+            return c;
+        }
+
+        // Bins with centroids in the cells around x, in creation order
+        void candidates(const T &x)
+        {
+            Cell c = cell(x), o;
+            int cells = 1;
+            for (int d = 0; d < N; d++)
+                cells *= 3;
+
+            cand.clear();
+            for (int k = 0; k < cells; k++)
+            {
+                for (int d = 0, m = k; d < N; d++, m /= 3)
+                    o[d] = c[d] + m % 3 - 1;
+
+                auto it = grid.find(o);
+                if (it != grid.end())
+                    cand.insert(cand.end(), it->second.begin(), it->second.end());
+            }
+            std::sort(cand.begin(), cand.end());
+        }
+
+        // Oldest bin whose centroid passes the threshold for x, -1 if none
+        int match(const T &x)
+        {
+            candidates(x);
+            for (int i : cand)
+                if (thresh(x, cens[i]))
+                    return i;
+            return -1;
+        }
+
+        int newBin(const T &s, size_t count)
+        {
+            int i = (int)counts.size();
+            sums.push_back(s);
+            counts.push_back(count);
+            cens.push_back(sum.centroid(s, count));
+            cells_.push_back(cell(cens[i]));
+            grid[cells_[i]].push_back(i);
+            return i;
+        }
+
+        // Recomputes bin i's centroid and moves it to its new cell if needed
+        void update(int i)
+        {
+            cens[i] = sum.centroid(sums[i], counts[i]);
+
+            Cell c = cell(cens[i]);
+            if (c == cells_[i])
+                return;
+
+            std::vector<int> &from = grid[cells_[i]];
+            *std::find(from.begin(), from.end(), i) = from.back();
+            from.pop_back();
+            if (from.empty())
+                grid.erase(cells_[i]);
+
+            grid[c].push_back(i);
+            cells_[i] = c;
+        }
+
+        // Counting sort of the memberships by bin
+        void build()
+        {
+            if (!dirty)
+                return;
+
+            offs.assign(size() + 1, 0);
+            for (const entry &e : entries)
+                offs[e.bin + 1]++;
+            for (size_t b = 0; b < size(); b++)
+                offs[b + 1] += offs[b];
+
+            mems.resize(entries.size());
+            std::vector<int> pos(offs.begin(), offs.end() - 1);
+            for (const entry &e : entries)
+                mems[pos[e.bin]++] = e.value;
+            dirty = false;
+        }
     };
 }
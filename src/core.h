@@ -17,6 +17,9 @@
 #include <set>
 #include <vector>
 #include <complex>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 #ifndef M_PI
 	#define M_PI		3.14159265358979323846
@@ -67,25 +70,72 @@
 
 namespace mg
 {
-	template <typename Derived>
-	struct Eig_hash { // Pseudo-unique integer hasher
-		size_t operator()(const Derived& t) const
-		{
-			size_t val = 0;
-			for (int i = 0; i < _Rows; i++) {
-				for (int j = 0; j < _Cols; j++) {
-					val = (41 * val) + (unsigned int)t(i, j);
-				}
-			}
-			return val;
-		}
-	};
-    
+    namespace detail
+    {
+        // splitmix64 finalizer
+        inline uint64_t mix64(uint64_t x)
+        {
+            x ^= x >> 30;
+            x *= 0xBF58476D1CE4E5B9ull;
+            x ^= x >> 27;
+            x *= 0x94D049BB133111EBull;
+            return x ^ (x >> 31);
+        }
+
+        // Bits of a coefficient, with -0.0 == 0.0 as for operator==
+        template <typename T>
+        inline typename std::enable_if<std::is_integral<T>::value, uint64_t>::type coeffBits(T v)
+        {
+            return (uint64_t)(int64_t)v;
+        }
+
+        template <typename T>
+        inline typename std::enable_if<std::is_floating_point<T>::value, uint64_t>::type coeffBits(T v)
+        {
+            double d = v == 0 ? 0. : (double)v;
+            uint64_t u;
+            std::memcpy(&u, &d, sizeof u);
+            return u;
+        }
+    }
+
+    // Hash of a Vec<T,N>, mixing every coefficient
+    template <typename T, int N>
+    struct Vec_hash {
+        size_t operator()(const Eigen::Matrix<T, N, 1> &v) const
+        {
+            uint64_t h = 0x9E3779B97F4A7C15ull;
+            for (int i = 0; i < N; i++)
+                h = detail::mix64(h ^ detail::coeffBits(v[i]));
+            return (size_t)h;
+        }
+    };
+
+    // Small integer vectors fit in one word and take a single mix
+    template <>
+    struct Vec_hash<int, 2> {
+        size_t operator()(const Eigen::Matrix<int, 2, 1> &v) const
+        {
+            return (size_t)detail::mix64(((uint64_t)(uint32_t)v[0] << 32) | (uint32_t)v[1]);
+        }
+    };
+
+    template <typename Derived>
+    struct Eig_hash { // Hash of any Eigen matrix, mixing every coefficient
+        size_t operator()(const Derived& t) const
+        {
+            uint64_t h = 0x9E3779B97F4A7C15ull;
+            for (Eigen::Index i = 0; i < t.size(); i++)
+                h = detail::mix64(h ^ detail::coeffBits(t.data()[i]));
+            return (size_t)h;
+        }
+    };
+
     template <typename Derived>
-    struct Eig_hash2X { // Pseudo-unique integer hasher
+    struct Eig_hash2X { // Hash of a 2-vector
         size_t operator()(const Derived& t) const
         {
-            return int(41 * t(0)) ^ int(t(1));
+            return (size_t)detail::mix64(detail::coeffBits(t(0)) * 0x9E3779B97F4A7C15ull ^ detail::coeffBits(t(1)));
         }
     };
 
@@ -162,7 +212,7 @@ namespace mg
         typename T,
         int N = 2,
         int M = 1,
-        typename _hash = Eig_hash2X<T>,
+        typename _hash = Eig_hash2X<Eigen::Matrix<T, N, M> >,
         typename _equals = std::equal_to<Eigen::Matrix<T, N, M> >,
         typename _alloc = Eigen::aligned_allocator<Eigen::Matrix<T, N, M> >
     >
@@ -196,7 +246,7 @@ namespace mg
 	typedef EigMap<int, VecSet3f> VecSetMap3f;
     
     typedef EigList<Vec2i> VecList2i;
-    typedef EigSet2X<Vec2i> VecSet2i;
+    typedef EigSet2X<int> VecSet2i;
     typedef EigMap<int, Vec2i> VecMap2i;
     typedef EigMap<int, VecList2i> VecSetMap2i;
     
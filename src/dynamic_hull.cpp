@@ -0,0 +1,123 @@
+#include "dynamic_hull.h"
+
+#include "geom.h"
+
+using namespace mg::geom;
+
+dynamic_hull::dynamic_hull() : dirty(false) {}
+
+dynamic_hull::~dynamic_hull() {}
+
+bool dynamic_hull::insert(const mg::Vec2 &p)
+{
+    // Both calls must run: a point can extend one chain and not the other
+    bool up = insertChain(upper, p.x(), p.y());
+    bool lo = insertChain(lower, p.x(), -p.y());
+
+    if (up || lo)
+        dirty = true;
+
+    return up || lo;
+}
+
+size_t dynamic_hull::insert(const mg::VecList2f &P)
+{
+    size_t n = 0;
+    for (const mg::Vec2 &p : P)
+        if (insert(p))
+            n++;
+
+    return n;
+}
+
+bool dynamic_hull::contains(const mg::Vec2 &p) const
+{
+    return underChain(upper, p.x(), p.y()) && underChain(lower, p.x(), -p.y());
+}
+
+const mg::VecList2f &dynamic_hull::hull() const
+{
+    if (!dirty)
+        return H;
+
+    H.clear();
+    for (auto it = lower.begin(); it != lower.end(); ++it)
+        H.push_back(mg::Vec2(it->first, -it->second));
+
+    // Upper chain right to left, skipping endpoints shared with the lower chain
+    for (auto it = upper.rbegin(); it != upper.rend(); ++it)
+    {
+        mg::Vec2 p(it->first, it->second);
+        if (p != H.back() && p != H.front())
+            H.push_back(p);
+    }
+
+    dirty = false;
+    return H;
+}
+
+void dynamic_hull::clear()
+{
+    upper.clear();
+    lower.clear();
+    H.clear();
+    dirty = false;
+}
+
+bool dynamic_hull::insertChain(chain &C, double x, double y)
+{
+    mg::Vec2 p(x, y);
+
+    auto it = C.lower_bound(x);
+    if (it != C.end() && it->first == x)
+    {
+        if (it->second >= y)
+            return false;
+        it = C.erase(it);
+    }
+    else if (it != C.end() && it != C.begin())
+    {
+        // Strictly between two chain vertices: reject if on or below their edge
+        auto prev = std::prev(it);
+        if (orient2d(mg::Vec2(prev->first, prev->second), mg::Vec2(it->first, it->second), p) <= 0)
+            return false;
+    }
+
+    it = C.emplace_hint(it, x, y);
+
+    // Remove vertices that are no longer strictly convex on either side
+    for (;;)
+    {
+        auto b = std::next(it);
+        if (b == C.end()) break;
+        auto c = std::next(b);
+        if (c == C.end()) break;
+        if (orient2d(p, mg::Vec2(b->first, b->second), mg::Vec2(c->first, c->second)) < 0) break;
+        C.erase(b);
+    }
+
+    while (it != C.begin())
+    {
+        auto b = std::prev(it);
+        if (b == C.begin()) break;
+        auto a = std::prev(b);
+        if (orient2d(mg::Vec2(a->first, a->second), mg::Vec2(b->first, b->second), p) < 0) break;
+        C.erase(b);
+    }
+
+    return true;
+}
+
+bool dynamic_hull::underChain(const chain &C, double x, double y)
+{
+    auto it = C.lower_bound(x);
+    if (it == C.end())
+        return false;
+    if (it->first == x)
+        return y <= it->second;
+    if (it == C.begin())
+        return false;
+
+    auto prev = std::prev(it);
+    return orient2d(mg::Vec2(prev->first, prev->second), mg::Vec2(it->first, it->second), mg::Vec2(x, y)) <= 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "core.h"
+
+#include <map>
+
+// Convex hull maintained under point insertion. The upper and lower chains are kept
+// ordered by x, so an insertion costs O(log h) plus the vertices it removes (amortized
+// O(log h)), and points inside the current hull are rejected after an O(log h) test.
+// Deleting points is not supported.
+class dynamic_hull
+{
+public:
+    dynamic_hull();
+    ~dynamic_hull();
+
+    // Adds p; returns false (and leaves the hull unchanged) if p lies inside or on the hull
+    bool insert(const mg::Vec2 &p);
+
+    // Adds every point of P and returns how many changed the hull
+    size_t insert(const mg::VecList2f &P);
+
+    // Whether p lies inside or on the current hull
+    bool contains(const mg::Vec2 &p) const;
+
+    // Current hull, counter-clockwise from the lowest-x (then lowest-y) vertex, not closed.
+    // Rebuilt from the chains in O(h) only after the hull has changed.
+    const mg::VecList2f &hull() const;
+
+    bool empty() const { return upper.empty(); }
+
+    void clear();
+
+private:
+    // x -> y of one monotone chain. The lower chain is stored with y negated so that
+    // both chains are handled as upper chains.
+    typedef std::map<double, double> chain;
+
+    chain upper, lower;
+
+    mutable mg::VecList2f H;
+    mutable bool dirty;
+
+    static bool insertChain(chain &C, double x, double y);
+    static bool underChain(const chain &C, double x, double y);
+};
@@ -0,0 +1,339 @@
+#pragma once
+
+#include "core.h"
+
+#if !defined(MG_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define MG_FLAT_HASH_SSE2
+#endif
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+namespace mg
+{
+    namespace detail
+    {
+        // Open addressing with one control byte per slot, probed 16 at a time.
+        // A control byte is empty (0x80), deleted (0xFE), or the low 7 hash bits of a full
+        // slot, so a group is matched against a key's hash with one SIMD compare and only
+        // the hits compare keys. Groups are visited with triangular probing.
+        namespace flat
+        {
+            const int groupSize = 16;
+            const int8_t empty = -128;
+            const int8_t deleted = -2;
+
+            struct group
+            {
+#ifdef MG_FLAT_HASH_SSE2
+                __m128i c;
+
+                explicit group(const int8_t *ctrl) : c(_mm_loadu_si128((const __m128i *)ctrl)) {}
+
+                unsigned match(int8_t h2) const { return (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(c, _mm_set1_epi8(h2))); }
+                unsigned matchEmpty() const { return match(empty); }
+                unsigned matchFree() const { return (unsigned)_mm_movemask_epi8(c); } // empty or deleted
+#else
+                const int8_t *c;
+
+                explicit group(const int8_t *ctrl) : c(ctrl) {}
+
+                unsigned match(int8_t h2) const
+                {
+                    unsigned m = 0;
+                    for (int i = 0; i < groupSize; i++)
+                        m |= (unsigned)(c[i] == h2) << i;
+                    return m;
+                }
+                unsigned matchEmpty() const { return match(empty); }
+                unsigned matchFree() const
+                {
+                    unsigned m = 0;
+                    for (int i = 0; i < groupSize; i++)
+                        m |= (unsigned)(c[i] < 0) << i;
+                    return m;
+                }
+#endif
+            };
+
+            inline int lowestBit(unsigned m)
+            {
+#if defined(__GNUC__) || defined(__clang__)
+                return __builtin_ctz(m);
+#else
+                int i = 0;
+                while (!(m & 1)) {
+                    m >>= 1;
+                    i++;
+                }
+                return i;
+#endif
+            }
+        }
+
+        // Table of Slot values keyed by KeyOf()(slot). Slots must be default constructible
+        // and assignable; they live in one aligned array next to the control bytes.
+        template <typename Key, typename Slot, typename KeyOf, typename Hash, typename Equals>
+        class flat_table
+        {
+        public:
+            template <bool Const>
+            class iter
+            {
+            public:
+                typedef typename std::conditional<Const, const flat_table, flat_table>::type table_type;
+                typedef typename std::conditional<Const, const Slot, Slot>::type value_type;
+
+                iter() : t(NULL), i(0) {}
+                iter(table_type *t, size_t i) : t(t), i(i) { skip(); }
+                iter(const iter<false> &o) : t(o.t), i(o.i) {}
+
+                value_type& operator*() const { return t->slots[i]; }
+                value_type* operator->() const { return &t->slots[i]; }
+                iter& operator++() { i++; skip(); return *this; }
+                iter operator++(int) { iter o = *this; ++*this; return o; }
+                bool operator==(const iter &o) const { return i == o.i; }
+                bool operator!=(const iter &o) const { return i != o.i; }
+
+            private:
+                friend class flat_table;
+                template <bool> friend class iter;
+
+                table_type *t;
+                size_t i;
+
+                void skip() { while (i < t->ctrl.size() && t->ctrl[i] < 0) i++; }
+            };
+
+            typedef iter<false> iterator;
+            typedef iter<true> const_iterator;
+
+            flat_table() : n(0), tomb(0) {}
+
+            iterator begin() { return iterator(this, 0); }
+            iterator end() { return iterator(this, ctrl.size()); }
+            const_iterator begin() const { return const_iterator(this, 0); }
+            const_iterator end() const { return const_iterator(this, ctrl.size()); }
+
+            size_t size() const { return n; }
+            bool empty() const { return n == 0; }
+            size_t bucket_count() const { return ctrl.size(); }
+
+            void clear()
+            {
+                std::fill(ctrl.begin(), ctrl.end(), flat::empty);
+                if (!std::is_trivially_destructible<Slot>::value)
+                    std::fill(slots.begin(), slots.end(), Slot());
+                n = tomb = 0;
+            }
+
+            // Makes room for count elements without rehashing
+            void reserve(size_t count)
+            {
+                size_t cap = flat::groupSize;
+                while (cap * 7 / 8 < count)
+                    cap *= 2;
+                if (cap > ctrl.size())
+                    rehash(cap);
+            }
+
+            iterator find(const Key &k) { return iterator(this, locate(k)); }
+            const_iterator find(const Key &k) const { return const_iterator(this, locate(k)); }
+            size_t count(const Key &k) const { return locate(k) != ctrl.size() ? 1 : 0; }
+
+            // Inserts s unless its key is present. Returns the element and whether it was inserted.
+            std::pair<iterator, bool> insert(const Slot &s)
+            {
+                bool added;
+                size_t i = slotFor(KeyOf()(s), added);
+                if (added)
+                    slots[i] = s;
+                return std::make_pair(iterator(this, i), added);
+            }
+
+            size_t erase(const Key &k)
+            {
+                size_t i = locate(k);
+                if (i == ctrl.size())
+                    return 0;
+                erase(iterator(this, i));
+                return 1;
+            }
+
+            iterator erase(iterator it)
+            {
+                // A group with an empty slot never continued a probe, so the slot can be emptied
+                size_t g = it.i / flat::groupSize * flat::groupSize;
+                bool wasFull = flat::group(&ctrl[g]).matchEmpty() == 0;
+                ctrl[it.i] = wasFull ? flat::deleted : flat::empty;
+                if (!std::is_trivially_destructible<Slot>::value)
+                    slots[it.i] = Slot();   // release what the element holds
+                n--;
+                if (wasFull)
+                    tomb++;
+                return ++it;
+            }
+
+        protected:
+            // Slot index for k, inserting an empty slot for it if missing
+            size_t slotFor(const Key &k, bool &added)
+            {
+                size_t i = locate(k);
+                if (i != ctrl.size()) {
+                    added = false;
+                    return i;
+                }
+
+                if ((n + tomb + 1) * 8 > ctrl.size() * 7)
+                    rehash(n + 1 > ctrl.size() * 7 / 16 ? std::max<size_t>(ctrl.size() * 2, flat::groupSize) : ctrl.size());
+
+                size_t h = hash(k);
+                i = freeSlot(h);
+                if (ctrl[i] == flat::deleted)
+                    tomb--;
+                ctrl[i] = h2(h);
+                n++;
+                added = true;
+                return i;
+            }
+
+            Slot& at(size_t i) { return slots[i]; }
+
+        private:
+            std::vector<int8_t> ctrl;
+            EigList<Slot> slots;
+            size_t n, tomb;
+
+            // Mixed again so identity hashes (std::hash<int>) spread over groups and tags
+            static size_t hash(const Key &k) { return (size_t)mix64((uint64_t)Hash()(k)); }
+            static int8_t h2(size_t h) { return (int8_t)(h & 0x7F); }
+            size_t groups() const { return ctrl.size() / flat::groupSize; }
+
+            size_t locate(const Key &k) const
+            {
+                if (n == 0)
+                    return ctrl.size();
+
+                size_t h = hash(k), mask = groups() - 1, g = (h >> 7) & mask;
+                for (size_t step = 1; ; step++)
+                {
+                    flat::group grp(&ctrl[g * flat::groupSize]);
+                    for (unsigned m = grp.match(h2(h)); m != 0; m &= m - 1) {
+                        size_t i = g * flat::groupSize + flat::lowestBit(m);
+                        if (Equals()(KeyOf()(slots[i]), k))
+                            return i;
+                    }
+                    if (grp.matchEmpty() != 0 || step > groups())
+                        return ctrl.size();
+                    g = (g + step) & mask;
+                }
+            }
+
+            size_t freeSlot(size_t h) const
+            {
+                size_t mask = groups() - 1, g = (h >> 7) & mask;
+                for (size_t step = 1; ; step++)
+                {
+                    unsigned m = flat::group(&ctrl[g * flat::groupSize]).matchFree();
+                    if (m != 0)
+                        return g * flat::groupSize + flat::lowestBit(m);
+                    g = (g + step) & mask;
+                }
+            }
+
+            void rehash(size_t cap)
+            {
+                std::vector<int8_t> oldCtrl(cap, flat::empty);
+                EigList<Slot> oldSlots(cap);
+                oldCtrl.swap(ctrl);
+                oldSlots.swap(slots);
+                tomb = 0;
+
+                for (size_t i = 0; i < oldCtrl.size(); i++) {
+                    if (oldCtrl[i] >= 0) {
+                        size_t h = hash(KeyOf()(oldSlots[i])), j = freeSlot(h);
+                        ctrl[j] = h2(h);
+                        slots[j] = std::move(oldSlots[i]);
+                    }
+                }
+            }
+        };
+
+        template <typename K>
+        struct identity_key
+        {
+            const K& operator()(const K &k) const { return k; }
+        };
+
+        template <typename K, typename V>
+        struct first_key
+        {
+            const K& operator()(const std::pair<K, V> &p) const { return p.first; }
+        };
+    }
+
+    // Open addressing hash set with contiguous storage and SIMD-probed control bytes,
+    // for keys that are default constructible (such as Eigen vectors).
+    template <
+        typename K,
+        typename _hash = std::hash<K>,
+        typename _equals = std::equal_to<K>
+    >
+    class flat_set : public detail::flat_table<K, K, detail::identity_key<K>, _hash, _equals>
+    {
+    };
+
+    // Open addressing hash map counterpart of flat_set. Elements are std::pair<K, V>,
+    // whose key must not be modified through an iterator.
+    template <
+        typename K,
+        typename V,
+        typename _hash = std::hash<K>,
+        typename _equals = std::equal_to<K>
+    >
+    class flat_map : public detail::flat_table<K, std::pair<K, V>, detail::first_key<K, V>, _hash, _equals>
+    {
+    public:
+        V& operator[](const K &k)
+        {
+            bool added;
+            std::pair<K, V> &s = this->at(this->slotFor(k, added));
+            if (added)
+                s = std::make_pair(k, V());
+            return s.second;
+        }
+    };
+
+    /**
+     * Flat stand-ins for EigSet, EigSet2X and EigMap
+     **/
+    template<
+        typename Derived,
+        typename _hash = Eig_hash<Derived>,
+        typename _equals = std::equal_to<Derived>
+    >
+        using FlatEigSet = flat_set<Derived, _hash, _equals>;
+
+    template<
+        typename T,
+        int N = 2,
+        int M = 1,
+        typename _hash = Eig_hash2X<Eigen::Matrix<T, N, M> >,
+        typename _equals = std::equal_to<Eigen::Matrix<T, N, M> >
+    >
+        using FlatEigSet2X = flat_set<Eigen::Matrix<T, N, M>, _hash, _equals>;
+
+    template<
+        typename KT,
+        typename VT,
+        typename _hash = std::hash<KT>,
+        typename _equals = std::equal_to<KT>
+    >
+        using FlatEigMap = flat_map<KT, VT, _hash, _equals>;
+
+    typedef FlatEigSet2X<double> FlatVecSet2f;
+    typedef FlatEigSet2X<int> FlatVecSet2i;
+    typedef FlatEigSet<Vec3i, Vec_hash<int, 3> > FlatVecSet3i;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "core.h"
+
+namespace mg
+{
+    namespace detail
+    {
+        // Nodes and weights of an Order-point Gauss-Legendre rule on [-1, 1]
+        template<int Order>
+        struct legendre_rule
+        {
+            double x[Order];
+            double w[Order];
+        };
+
+        // cos(x) for x in [0, pi], usable in constant expressions
+        constexpr double cos_cx(double x)
+        {
+            double term = 1, sum = 1;
+            for (int k = 1; k < 40; k++) {
+                term *= -x * x / ((2 * k - 1) * (2 * k));
+                sum += term;
+            }
+            return sum;
+        }
+
+        // Roots of P_Order by Newton iteration from the usual cosine guesses
+        template<int Order>
+        constexpr legendre_rule<Order> make_legendre_rule()
+        {
+            legendre_rule<Order> r{};
+            for (int i = 0; i < (Order + 1) / 2; i++)
+            {
+                double z = cos_cx(M_PI * (i + 0.75) / (Order + 0.5));
+                double dp = 1;
+                for (int it = 0; it < 100; it++)
+                {
+                    double p1 = 1, p2 = 0;
+                    for (int j = 0; j < Order; j++) {
+                        double p3 = p2;
+                        p2 = p1;
+                        p1 = ((2 * j + 1) * z * p2 - j * p3) / (j + 1);
+                    }
+                    dp = Order * (z * p1 - p2) / (z * z - 1);
+
+                    double dz = p1 / dp;
+                    z -= dz;
+                    if (dz < 1e-16 && dz > -1e-16)
+                        break;
+                }
+                r.x[i] = -z;
+                r.x[Order - 1 - i] = z;
+                r.w[i] = r.w[Order - 1 - i] = 2 / ((1 - z * z) * dp * dp);
+            }
+            return r;
+        }
+    }
+
+    // Tensor-product Gauss-Legendre quadrature of fixed order over 1D, 2D and 3D boxes.
+    // The rule is computed at compile time, so the loops have constant trip counts and
+    // unroll/vectorize. An Order-point rule is exact for polynomials of degree 2*Order - 1
+    // in each variable.
+    template<int Order>
+    class gauss_legendre
+    {
+    public:
+        static constexpr detail::legendre_rule<Order> rule = detail::make_legendre_rule<Order>();
+
+        // Integrates f(u) over [u1, u2]
+        template<typename Fn>
+        static double Integrate(Fn f, double u1, double u2)
+        {
+            double hu = (u2 - u1) / 2, cu = (u1 + u2) / 2;
+
+            double sum = 0;
+            for (int i = 0; i < Order; i++)
+                sum += rule.w[i] * f(cu + hu * rule.x[i]);
+
+            return hu * sum;
+        }
+
+        // Integrates f(u, v) over [u1, u2] x [v1, v2]
+        template<typename Fn>
+        static double Integrate(Fn f, double u1, double u2, double v1, double v2)
+        {
+            double hu = (u2 - u1) / 2, cu = (u1 + u2) / 2;
+            double hv = (v2 - v1) / 2, cv = (v1 + v2) / 2;
+
+            double sum = 0;
+            for (int i = 0; i < Order; i++)
+            {
+                double ui = cu + hu * rule.x[i];
+                double row = 0;
+                for (int j = 0; j < Order; j++)
+                    row += rule.w[j] * f(ui, cv + hv * rule.x[j]);
+                sum += rule.w[i] * row;
+            }
+
+            return hu * hv * sum;
+        }
+
+        // Integrates f(u, v, w) over [u1, u2] x [v1, v2] x [w1, w2]
+        template<typename Fn>
+        static double Integrate(Fn f, double u1, double u2, double v1, double v2, double w1, double w2)
+        {
+            double hu = (u2 - u1) / 2, cu = (u1 + u2) / 2;
+            double hv = (v2 - v1) / 2, cv = (v1 + v2) / 2;
+            double hw = (w2 - w1) / 2, cw = (w1 + w2) / 2;
+
+            double sum = 0;
+            for (int i = 0; i < Order; i++)
+            {
+                double ui = cu + hu * rule.x[i];
+                double plane = 0;
+                for (int j = 0; j < Order; j++)
+                {
+                    double vj = cv + hv * rule.x[j];
+                    double row = 0;
+                    for (int k = 0; k < Order; k++)
+                        row += rule.w[k] * f(ui, vj, cw + hw * rule.x[k]);
+                    plane += rule.w[j] * row;
+                }
+                sum += rule.w[i] * plane;
+            }
+
+            return hu * hv * hw * sum;
+        }
+    };
+
+    template<int Order>
+    constexpr detail::legendre_rule<Order> gauss_legendre<Order>::rule;
+}
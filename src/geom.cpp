@@ -1,5 +1,9 @@
 #include "geom.h"
 
+#include "parallel.h"
+
+#include <limits>
+
 namespace mg
 {
     namespace geom
@@ -8,6 +12,64 @@ namespace mg
             return perp(v1).dot(v2);
         }
 
+        // Error-free transformations for orient2d's exact fallback
+        static inline void twoSum(double a, double b, double &x, double &y)
+        {
+            x = a + b;
+            double bv = x - a, av = x - bv;
+            y = (a - av) + (b - bv);
+        }
+
+        static inline void twoProduct(double a, double b, double &x, double &y)
+        {
+            x = a * b;
+            y = std::fma(a, b, -x);
+        }
+
+        // Adds b to the nonoverlapping expansion e[0..n), dropping zero components
+        static inline int growExpansion(double *e, int n, double b)
+        {
+            double Q = b;
+            int k = 0;
+            for (int i = 0; i < n; i++) {
+                double x, y;
+                twoSum(Q, e[i], x, y);
+                Q = x;
+                if (y != 0.)
+                    e[k++] = y;
+            }
+            if (Q != 0. || k == 0)
+                e[k++] = Q;
+            return k;
+        }
+
+        int orient2d(const Vec2 &a, const Vec2 &b, const Vec2 &c)
+        {
+            double l = (b.x() - a.x()) * (c.y() - a.y());
+            double r = (b.y() - a.y()) * (c.x() - a.x());
+            double det = l - r;
+
+            // Shewchuk's ccwerrboundA
+            if (std::abs(det) > 3.3306690738754716e-16 * (std::abs(l) + std::abs(r)))
+                return det > 0 ? 1 : -1;
+
+            // det = ax*by - ax*cy - ay*bx + ay*cx + bx*cy - by*cx, with every product exact
+            const double terms[6][2] = {
+                { a.x(), b.y() }, { -a.x(), c.y() }, { -a.y(), b.x() },
+                { a.y(), c.x() }, { b.x(), c.y() }, { -b.y(), c.x() } };
+
+            double e[12];
+            int n = 0;
+            for (int i = 0; i < 6; i++) {
+                double x, y;
+                twoProduct(terms[i][0], terms[i][1], x, y);
+                n = growExpansion(e, n, y);
+                n = growExpansion(e, n, x);
+            }
+
+            return sign(e[n - 1]);
+        }
+
         Mat3 crossVec(const Vec3 &v) {
             Mat3 res;
             res << 0, -v(2), v(1),
@@ -145,5 +207,156 @@ namespace mg
         {
             return abs(cos(l[1])*p.x() + sin(l[1])*p.y() - l[0]) < eq;
         }
+
+        /**
+        * Rotating calipers
+        */
+        // Vertex count without a repeated closing vertex
+        static int hullSize(const VecList2f &H)
+        {
+            int n = (int)H.size();
+            if (n > 1 && H[n - 1] == H[0])
+                n--;
+            return n;
+        }
+
+        double hullDiameter(const VecList2f &H, int *i_, int *j_)
+        {
+            int n = hullSize(H);
+            int bi = 0, bj = 0;
+            double best = 0;
+
+            if (n == 2) {
+                best = (H[1] - H[0]).squaredNorm();
+                bj = 1;
+            }
+            else if (n > 2)
+            {
+                // For each edge, advance the antipodal vertex while the triangle area grows
+                int j = 1;
+                for (int i = 0; i < n; i++)
+                {
+                    int i1 = (i + 1) % n;
+                    Vec2 e = H[i1] - H[i];
+                    for (int k = 0; k < n && cross2(e, H[(j + 1) % n] - H[i]) > cross2(e, H[j] - H[i]); k++)
+                        j = (j + 1) % n;
+
+                    double d1 = (H[j] - H[i]).squaredNorm(), d2 = (H[j] - H[i1]).squaredNorm();
+                    if (d1 > best) { best = d1; bi = i; bj = j; }
+                    if (d2 > best) { best = d2; bi = i1; bj = j; }
+                }
+            }
+
+            if (i_ != NULL) *i_ = bi;
+            if (j_ != NULL) *j_ = bj;
+            return sqrt(best);
+        }
+
+        double hullWidth(const VecList2f &H, Vec2 *normal)
+        {
+            int n = hullSize(H);
+            double best = 0;
+            Vec2 bn = Vec2(0, 1);
+
+            if (n == 2)
+                bn = perp(H[1] - H[0]).normalized();
+            else if (n > 2)
+            {
+                best = std::numeric_limits<double>::infinity();
+                int j = 1;
+                for (int i = 0; i < n; i++)
+                {
+                    Vec2 e = H[(i + 1) % n] - H[i];
+                    for (int k = 0; k < n && cross2(e, H[(j + 1) % n] - H[i]) > cross2(e, H[j] - H[i]); k++)
+                        j = (j + 1) % n;
+
+                    double len = e.norm();
+                    double w = cross2(e, H[j] - H[i]) / len;
+                    if (w < best) {
+                        best = w;
+                        bn = perp(e) / len;
+                    }
+                }
+            }
+
+            if (normal != NULL) *normal = bn;
+            return best;
+        }
+
+        oriented_rect minAreaRect(const VecList2f &H)
+        {
+            int n = hullSize(H);
+            oriented_rect res;
+            res.axis = Vec2(1, 0);
+            res.center = n > 0 ? H[0] : Vec2(Vec2::Zero());
+            res.halfExtents.setZero();
+            res.area = 0;
+
+            if (n == 2)
+            {
+                Vec2 e = H[1] - H[0];
+                res.axis = e.normalized();
+                res.center = (H[0] + H[1]) / 2;
+                res.halfExtents = Vec2(e.norm() / 2, 0);
+            }
+            if (n <= 2)
+                return res;
+
+            // Calipers: r is extreme along the edge, t along its inward normal, l against the edge
+            res.area = std::numeric_limits<double>::infinity();
+            int r = 0, t = 0, l = 0;
+            for (int i = 0; i < n; i++)
+            {
+                Vec2 u = (H[(i + 1) % n] - H[i]).normalized();
+                Vec2 v = perp(u);
+
+                if (i == 0) r = 1;
+                for (int k = 0; k < n && u.dot(H[(r + 1) % n] - H[r]) > 0; k++)
+                    r = (r + 1) % n;
+                if (i == 0) t = r;
+                for (int k = 0; k < n && v.dot(H[(t + 1) % n] - H[t]) > 0; k++)
+                    t = (t + 1) % n;
+                if (i == 0) l = t;
+                for (int k = 0; k < n && u.dot(H[(l + 1) % n] - H[l]) < 0; k++)
+                    l = (l + 1) % n;
+
+                double umax = u.dot(H[r] - H[i]), umin = u.dot(H[l] - H[i]);
+                double vmax = v.dot(H[t] - H[i]);
+                double area = (umax - umin) * vmax;
+                if (area < res.area)
+                {
+                    res.area = area;
+                    res.axis = u;
+                    res.halfExtents = Vec2((umax - umin) / 2, vmax / 2);
+                    res.center = H[i] + u * (umax + umin) / 2 + v * vmax / 2;
+                }
+            }
+
+            return res;
+        }
+
+        void hullDiameter(const std::vector<VecList2f> &hulls, double *diameters, int threads)
+        {
+            parallel::forChunks(hulls.size(), threads, 64, [&](size_t begin, size_t end, int) {
+                for (size_t k = begin; k < end; k++)
+                    diameters[k] = hullDiameter(hulls[k]);
+            });
+        }
+
+        void hullWidth(const std::vector<VecList2f> &hulls, double *widths, int threads)
+        {
+            parallel::forChunks(hulls.size(), threads, 64, [&](size_t begin, size_t end, int) {
+                for (size_t k = begin; k < end; k++)
+                    widths[k] = hullWidth(hulls[k]);
+            });
+        }
+
+        void minAreaRect(const std::vector<VecList2f> &hulls, oriented_rect *rects, int threads)
+        {
+            parallel::forChunks(hulls.size(), threads, 64, [&](size_t begin, size_t end, int) {
+                for (size_t k = begin; k < end; k++)
+                    rects[k] = minAreaRect(hulls[k]);
+            });
+        }
     }
 }
\ No newline at end of file
@@ -8,6 +8,10 @@ namespace mg
     {
         double cross2(const Vec2&, const Vec2&);
 
+        // Exact sign of cross2(b - a, c - a): 1 if a, b, c turn counter-clockwise, -1 if clockwise,
+        // 0 if collinear. Falls back to exact expansion arithmetic when the fast estimate is ambiguous.
+        int orient2d(const Vec2 &a, const Vec2 &b, const Vec2 &c);
+
         Mat3 crossVec(const Vec3& v);
 
         Vec2 perp(const Vec2 &v);
@@ -41,6 +45,32 @@ namespace mg
         // Check if a point lies within some distance eq on a hough line
         bool line_contains(const mg::Vec2 &l, const mg::Vec2 &p, double eq = 1e-5);
 
+        /**
+        * Rotating calipers over a convex hull given counter-clockwise without collinear
+        * vertices (as from graham_scan; a repeated closing vertex is ignored). All run in O(h).
+        **/
+        struct oriented_rect
+        {
+            Vec2 center;
+            Vec2 axis;          // unit direction of the first side
+            Vec2 halfExtents;   // along axis and perp(axis)
+            double area;
+        };
+
+        // Largest distance between two hull vertices (optionally their indices)
+        double hullDiameter(const VecList2f &H, int *i = NULL, int *j = NULL);
+
+        // Smallest distance between two parallel supporting lines (optionally their unit normal)
+        double hullWidth(const VecList2f &H, Vec2 *normal = NULL);
+
+        // Minimum-area enclosing rectangle (it has a side on a hull edge)
+        oriented_rect minAreaRect(const VecList2f &H);
+
+        // Batch variants over many hulls, split across threads (<= 0: hardware concurrency)
+        void hullDiameter(const std::vector<VecList2f> &hulls, double *diameters, int threads = 1);
+        void hullWidth(const std::vector<VecList2f> &hulls, double *widths, int threads = 1);
+        void minAreaRect(const std::vector<VecList2f> &hulls, oriented_rect *rects, int threads = 1);
+
     }
 }
 
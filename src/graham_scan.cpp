@@ -2,6 +2,9 @@
 
 #include "geom.h"
 #include "algs.h"
+#include "parallel.h"
+
+#include <algorithm>
 
 using namespace mg::geom;
 
@@ -14,51 +17,122 @@ mg::VecList2f graham_scan::ConvexHull(const mg::VecList2f &P)
     return graham_scan(P).convexHull();
 }
 
+// Returns the closed hull polygon (first point repeated at the end)
 mg::VecList2f graham_scan::convexHull()
 {
     size_t sz = P.size();
-    if (sz <= 3)
+    if (sz == 0)
         return P;
 
-    mg::VecList2f S;
+    mg::VecList2f S(sz + 1), work(sz);
+    size_t k = MonotoneChain(P.data(), sz, S.data(), work.data());
+
+    S.resize(k);
+    S.push_back(S.front());
 
-    // find start point (lowest)
-    int minIndex;
-    mg::Vec2 p0 = mg::algs::min(P, 0, minIndex);
+    return S;
+}
 
-    // calculate phase angles
-    mg::EigOrdMap<double, mg::Vec2> M;
-    for (int i = 0; i < sz; i++)
+size_t graham_scan::aklToussaint(const mg::Vec2 *P, size_t n, mg::Vec2 *out)
+{
+    // Extremes in x, y, x + y and x - y, in counter-clockwise order
+    size_t ext[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    for (size_t i = 1; i < n; i++)
     {
-        double ang = normAng(atan2(P[i].y(), P[i].x()));
-        M.insert(std::make_pair(ang, P[i]));
+        const mg::Vec2 &p = P[i];
+        double s = p.x() + p.y(), d = p.x() - p.y();
+        if (p.x() < P[ext[0]].x()) ext[0] = i;                               // left
+        if (s < P[ext[1]].x() + P[ext[1]].y()) ext[1] = i;                   // bottom-left
+        if (p.y() < P[ext[2]].y()) ext[2] = i;                               // bottom
+        if (d > P[ext[3]].x() - P[ext[3]].y()) ext[3] = i;                   // bottom-right
+        if (p.x() > P[ext[4]].x()) ext[4] = i;                               // right
+        if (s > P[ext[5]].x() + P[ext[5]].y()) ext[5] = i;                   // top-right
+        if (p.y() > P[ext[6]].y()) ext[6] = i;                               // top
+        if (d < P[ext[7]].x() - P[ext[7]].y()) ext[7] = i;                   // top-left
     }
 
-    int i = 0;
-    for (std::pair<double, mg::Vec2> tuple : M)
+    mg::Vec2 poly[8];
+    int m = 0;
+    for (int j = 0; j < 8; j++)
+        if (m == 0 || P[ext[j]] != poly[m - 1])
+            poly[m++] = P[ext[j]];
+    while (m > 1 && poly[m - 1] == poly[0])
+        m--;
+
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++)
     {
-        mg::Vec2 &pi = tuple.second;
-        
-        if (i++ >= 2)
-        {
-            while (S.size() > 1 && rightTurn(S, pi))
-            {
-                S.pop_back();
-            }
-        }
-
-        S.push_back(pi);
+        bool inside = m >= 3;
+        for (int j = 0; j < m && inside; j++)
+            inside = orient2d(poly[j], poly[(j + 1) % m], P[i]) > 0;
+
+        if (!inside)
+            out[k++] = P[i];
     }
 
-    S.push_back(S.front());
+    return k;
+}
 
-    return S;
+size_t graham_scan::MonotoneChain(const mg::Vec2 *P, size_t n, mg::Vec2 *H, mg::Vec2 *work)
+{
+    if (n == 0)
+        return 0;
+
+    size_t m = aklToussaint(P, n, work);
+    std::sort(work, work + m, [](const mg::Vec2 &a, const mg::Vec2 &b) {
+        return a.x() < b.x() || (a.x() == b.x() && a.y() < b.y());
+    });
+
+    if (m < 2 || work[0] == work[m - 1]) {
+        H[0] = work[0];
+        return 1;
+    }
+
+    // Lower hull, then upper hull
+    size_t k = 0;
+    for (size_t i = 0; i < m; i++)
+    {
+        while (k >= 2 && orient2d(H[k - 2], H[k - 1], work[i]) <= 0)
+            k--;
+        H[k++] = work[i];
+    }
+
+    for (size_t i = m - 1, lower = k + 1; i-- > 0;)
+    {
+        while (k >= lower && orient2d(H[k - 2], H[k - 1], work[i]) <= 0)
+            k--;
+        H[k++] = work[i];
+    }
+
+    // The last point is the first one again
+    return k - 1;
 }
 
-bool graham_scan::rightTurn(mg::VecList2f &S, const mg::Vec2 &pi)
+size_t graham_scan::MonotoneChainParallel(const mg::Vec2 *P, size_t n, mg::Vec2 *H,
+    int threads, size_t minPerThread)
 {
-    auto iter = S.rbegin();
-    const mg::Vec2 &pi1 = *iter;
-    const mg::Vec2 &pi2 = *++iter;
-    return cross2(pi1 - pi2, pi - pi2) < 0;
-}
\ No newline at end of file
+    threads = (int)std::min<size_t>(mg::parallel::threadCount(threads), n / std::max<size_t>(minPerThread, 1));
+    if (threads <= 1)
+    {
+        mg::VecList2f work(n);
+        return MonotoneChain(P, n, H, work.data());
+    }
+
+    // Chunk k writes its hull (at most len + 1 points) at sub[begin + k]
+    mg::VecList2f sub(n + threads), work(n);
+    std::vector<size_t> counts(threads);
+    mg::parallel::forRange(n, threads, [&](size_t begin, size_t end, int k) {
+        counts[k] = MonotoneChain(P + begin, end - begin, &sub[begin + k], &work[begin]);
+    });
+
+    // Gather the sub-hull vertices to the front and merge them
+    size_t m = 0;
+    for (int k = 0; k < threads; k++)
+    {
+        size_t begin = n * k / threads + k;
+        for (size_t i = 0; i < counts[k]; i++)
+            sub[m++] = sub[begin + i];
+    }
+
+    return MonotoneChain(sub.data(), m, H, work.data());
+}
@@ -12,9 +12,23 @@ public:
 
     mg::VecList2f convexHull();
 
+    // Andrew's monotone chain hull of P[0..n) with an Akl-Toussaint pre-filter that discards
+    // points strictly inside the octagon of extreme points. Uses exact orientation tests.
+    // Writes the hull counter-clockwise from the lowest-x (then lowest-y) point, without
+    // repeating it and without collinear points, to H and returns its size.
+    // H must have room for n + 1 points and work (scratch) for n points.
+    static size_t MonotoneChain(const mg::Vec2 *P, size_t n, mg::Vec2 *H, mg::Vec2 *work);
+
+    // Parallel divide and conquer variant of MonotoneChain: P is split into one contiguous
+    // range per thread, the sub-hulls are computed concurrently and merged by a final
+    // MonotoneChain over their vertices. Runs sequentially when there are fewer than
+    // minPerThread points per thread (see bench/hull_bench.cpp). H must have room for n + 1 points.
+    static size_t MonotoneChainParallel(const mg::Vec2 *P, size_t n, mg::Vec2 *H,
+        int threads = 0, size_t minPerThread = 1 << 13);
+
 private:
     const mg::VecList2f &P;
 
-    static bool rightTurn(mg::VecList2f &S, const mg::Vec2 &pi);
+    // Copies the points of P[0..n) not strictly inside the extreme-point octagon to out
+    static size_t aklToussaint(const mg::Vec2 *P, size_t n, mg::Vec2 *out);
 };
-
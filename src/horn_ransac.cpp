@@ -0,0 +1,301 @@
+#include "horn_ransac.h"
+
+#include "horns_alg.hpp"
+#include "parallel.h"
+#include "simd.h"
+
+#include <limits>
+#include <random>
+
+namespace mg
+{
+    namespace
+    {
+        // Correspondences checked between SPRT decisions (a multiple of the SIMD width)
+        const size_t block = 64;
+
+        // Cost of generating a hypothesis, in correspondence checks, for the SPRT threshold
+        const double modelCost = 200;
+    }
+
+    horn_ransac::horn_ransac(double threshold, double confidence, int maxIter, int threads) :
+        threshold(threshold), confidence(confidence), maxIter(maxIter), threads(threads),
+        batch(32), sprt(true), seed(0), n(0), iters(0)
+    {
+    }
+
+    horn_ransac::~horn_ransac()
+    {
+    }
+
+    int horn_ransac::estimate(const VecList3f &P, const VecList3f &Q, Quaternion &r, Vec3 *t, std::vector<int> *inliers)
+    {
+        n = std::min(P.size(), Q.size());
+        iters = 0;
+        if (inliers != NULL)
+            inliers->clear();
+        if (n < 3)
+            return 0;
+
+        // SoA copies for the SIMD scoring and refits
+        px.resize(n); py.resize(n); pz.resize(n);
+        qx.resize(n); qy.resize(n); qz.resize(n);
+        w.resize(n);
+        mask.resize(n);
+        for (size_t i = 0; i < n; i++) {
+            px[i] = P[i].x(); py[i] = P[i].y(); pz[i] = P[i].z();
+            qx[i] = Q[i].x(); qy[i] = Q[i].y(); qz[i] = Q[i].z();
+        }
+
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int> pick(0, (int)n - 1);
+
+        int best = 0;
+        Mat3 bestR;
+        Vec3 bestT;
+
+        // SPRT state: eps is the inlier ratio of a good model, delta the fraction of
+        // correspondences consistent with a bad one. Off until a first model is found.
+        double eps = 0, delta = 0.05, logA = std::numeric_limits<double>::infinity();
+
+        long required = maxIter;
+        while (iters < required)
+        {
+            // Samples are drawn here so they don't depend on scheduling
+            int m = (int)std::min<long>(std::max(batch, 1), required - iters);
+            hyps.resize(m);
+            for (int j = 0; j < m; j++) {
+                int *s = hyps[j].s;
+                s[0] = pick(rng);
+                do { s[1] = pick(rng); } while (s[1] == s[0]);
+                do { s[2] = pick(rng); } while (s[2] == s[0] || s[2] == s[1]);
+            }
+
+            parallel::forChunks(m, threads, 1, [&](size_t begin, size_t end, int) {
+                for (size_t j = begin; j < end; j++) {
+                    solve(hyps[j]);
+                    if (hyps[j].valid)
+                        score(hyps[j], best, eps, delta, logA);
+                }
+            });
+            iters += m;
+
+            // Reduce in hypothesis order
+            int prevBest = best;
+            double badChecked = 0, badConsistent = 0;
+            for (int j = 0; j < m; j++)
+            {
+                const hypothesis &h = hyps[j];
+                if (!h.valid)
+                    continue;
+
+                if (!h.rejected && h.inliers > best) {
+                    best = h.inliers;
+                    bestR = h.R;
+                    bestT = h.t;
+                }
+                else if (h.checked > 0) {
+                    badChecked += h.checked;
+                    badConsistent += h.inliers;
+                }
+            }
+
+            if (badChecked > 0)
+                delta = std::min(std::max(badConsistent / badChecked, 1e-4), 0.5);
+
+            if (best > prevBest)
+                eps = (double)best / n;
+
+            // SPRT is only meaningful while good models are more consistent than bad ones
+            logA = sprt && eps > 0 && delta < eps ? sprtThreshold(eps, delta) : std::numeric_limits<double>::infinity();
+
+            // Adaptive iteration count, accounting for good models falsely rejected by SPRT
+            double pGood = eps * eps * eps * (std::isinf(logA) ? 1. : 1. - std::exp(-logA));
+            if (pGood >= 1)
+                required = iters;
+            else if (pGood > 0) {
+                double k = std::log(1 - confidence) / std::log(1 - pGood);
+                required = k < maxIter ? std::max<long>(iters, (long)std::ceil(k)) : maxIter;
+            }
+        }
+
+        if (best < 3)
+            return 0;
+
+        // Refit on the inliers (weights 0/1), repeating while the consensus grows
+        best = classify(bestR, bestT, w.data());
+        for (int k = 0; k < 4; k++)
+        {
+            Quaternion rk;
+            Vec3 tk;
+            if (abs_ori_horn(px.data(), py.data(), pz.data(), qx.data(), qy.data(), qz.data(), n, rk, &tk, w.data()) != 1)
+                break;
+
+            Mat3 Rk = rk.toRotationMatrix();
+            int count = classify(Rk, tk, mask.data());
+            if (count < best)
+                break;
+
+            bool grew = count > best;
+            best = count;
+            bestR = Rk;
+            bestT = tk;
+            w.swap(mask);
+            if (!grew)
+                break;
+        }
+
+        r = Quaternion(bestR);
+        if (t != NULL)
+            *t = bestT;
+
+        if (inliers != NULL) {
+            inliers->reserve(best);
+            for (size_t i = 0; i < n; i++)
+                if (w[i] != 0)
+                    inliers->push_back((int)i);
+        }
+
+        return best;
+    }
+
+    void horn_ransac::solve(hypothesis &h) const
+    {
+        Vec3 p[3], q[3];
+        for (int k = 0; k < 3; k++) {
+            p[k] = Vec3(px[h.s[k]], py[h.s[k]], pz[h.s[k]]);
+            q[k] = Vec3(qx[h.s[k]], qy[h.s[k]], qz[h.s[k]]);
+        }
+
+        h.valid = false;
+        h.rejected = false;
+        h.inliers = 0;
+        h.checked = 0;
+
+        // Reject (near) collinear samples, which leave the rotation undetermined
+        Vec3 ep = (p[1] - p[0]).cross(p[2] - p[0]), eq = (q[1] - q[0]).cross(q[2] - q[0]);
+        double sp = std::max((p[1] - p[0]).squaredNorm(), (p[2] - p[0]).squaredNorm());
+        double sq = std::max((q[1] - q[0]).squaredNorm(), (q[2] - q[0]).squaredNorm());
+        if (ep.squaredNorm() <= 1e-12 * sp * sp || eq.squaredNorm() <= 1e-12 * sq * sq)
+            return;
+
+        Vec3 pbar = (p[0] + p[1] + p[2]) / 3, qbar = (q[0] + q[1] + q[2]) / 3;
+        Mat3 S = Mat3::Zero();
+        for (int k = 0; k < 3; k++)
+            S.noalias() += (p[k] - pbar) * (q[k] - qbar).transpose();
+
+        Quaternion r;
+        if (abs_ori_horn(S, pbar, qbar, r, &h.t) != 1)
+            return;
+
+        h.R = r.toRotationMatrix();
+        h.valid = true;
+    }
+
+    void horn_ransac::score(hypothesis &h, int best, double eps, double delta, double logA) const
+    {
+        using namespace simd;
+
+        const Mat3 &R = h.R;
+        const double thr2 = threshold * threshold;
+        const double lIn = std::log(delta / eps), lOut = std::log((1 - delta) / (1 - eps));
+        const bool test = !std::isinf(logA);
+
+        const packd r00 = set1(R(0, 0)), r01 = set1(R(0, 1)), r02 = set1(R(0, 2));
+        const packd r10 = set1(R(1, 0)), r11 = set1(R(1, 1)), r12 = set1(R(1, 2));
+        const packd r20 = set1(R(2, 0)), r21 = set1(R(2, 1)), r22 = set1(R(2, 2));
+        const packd tx = set1(h.t.x()), ty = set1(h.t.y()), tz = set1(h.t.z());
+        const packd t2 = set1(thr2), one = set1(1.), zero = set1(0.);
+
+        int inl = 0;
+        double logL = 0;
+        size_t i = 0;
+        while (i < n)
+        {
+            size_t start = i, end = std::min(i + block, n);
+            int count = 0;
+
+            packd acc = zero;
+            for (; i + width <= end; i += width)
+            {
+                packd x = load(&px[i]), y = load(&py[i]), z = load(&pz[i]);
+                packd dx = sub(fmadd(r00, x, fmadd(r01, y, fmadd(r02, z, tx))), load(&qx[i]));
+                packd dy = sub(fmadd(r10, x, fmadd(r11, y, fmadd(r12, z, ty))), load(&qy[i]));
+                packd dz = sub(fmadd(r20, x, fmadd(r21, y, fmadd(r22, z, tz))), load(&qz[i]));
+                packd d2 = fmadd(dx, dx, fmadd(dy, dy, mul(dz, dz)));
+                acc = add(acc, select(le(d2, t2), one, zero));
+            }
+            count += (int)hsum(acc);
+
+            for (; i < end; i++) {
+                Vec3 d = R * Vec3(px[i], py[i], pz[i]) + h.t - Vec3(qx[i], qy[i], qz[i]);
+                if (d.squaredNorm() <= thr2)
+                    count++;
+            }
+
+            inl += count;
+            h.checked = (int)end;
+            h.inliers = inl;
+
+            // Can't beat the best model
+            if (inl + (int)(n - end) <= best) {
+                h.rejected = true;
+                return;
+            }
+
+            // Likelihood ratio of bad vs good model over the correspondences seen so far
+            if (test) {
+                logL += count * lIn + (double)(end - start - count) * lOut;
+                if (logL > logA) {
+                    h.rejected = true;
+                    return;
+                }
+            }
+        }
+    }
+
+    int horn_ransac::classify(const Mat3 &R, const Vec3 &t, double *mask) const
+    {
+        using namespace simd;
+
+        const double thr2 = threshold * threshold;
+        const packd r00 = set1(R(0, 0)), r01 = set1(R(0, 1)), r02 = set1(R(0, 2));
+        const packd r10 = set1(R(1, 0)), r11 = set1(R(1, 1)), r12 = set1(R(1, 2));
+        const packd r20 = set1(R(2, 0)), r21 = set1(R(2, 1)), r22 = set1(R(2, 2));
+        const packd tx = set1(t.x()), ty = set1(t.y()), tz = set1(t.z());
+        const packd t2 = set1(thr2), one = set1(1.), zero = set1(0.);
+
+        packd acc = zero;
+        size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            packd x = load(&px[i]), y = load(&py[i]), z = load(&pz[i]);
+            packd dx = sub(fmadd(r00, x, fmadd(r01, y, fmadd(r02, z, tx))), load(&qx[i]));
+            packd dy = sub(fmadd(r10, x, fmadd(r11, y, fmadd(r12, z, ty))), load(&qy[i]));
+            packd dz = sub(fmadd(r20, x, fmadd(r21, y, fmadd(r22, z, tz))), load(&qz[i]));
+            packd m = select(le(fmadd(dx, dx, fmadd(dy, dy, mul(dz, dz))), t2), one, zero);
+            store(mask + i, m);
+            acc = add(acc, m);
+        }
+
+        int count = (int)hsum(acc);
+        for (; i < n; i++) {
+            Vec3 d = R * Vec3(px[i], py[i], pz[i]) + t - Vec3(qx[i], qy[i], qz[i]);
+            mask[i] = d.squaredNorm() <= thr2 ? 1. : 0.;
+            count += (int)mask[i];
+        }
+
+        return count;
+    }
+
+    double horn_ransac::sprtThreshold(double eps, double delta)
+    {
+        // Matas & Chum: A is the fixed point of A = K + log(A)
+        double C = (1 - delta) * std::log((1 - delta) / (1 - eps)) + delta * std::log(delta / eps);
+        double K = modelCost * C + 1;
+        double A = K;
+        for (int k = 0; k < 10; k++)
+            A = K + std::log(A);
+        return std::log(A);
+    }
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "core.h"
+
+namespace mg
+{
+    // RANSAC over abs_ori_horn for correspondences Q_i ~ r P_i + t with outliers.
+    // Minimal 3-point hypotheses are generated in batches and scored against all
+    // correspondences in parallel with SIMD residuals. Scoring stops early on a hypothesis
+    // once it can't beat the best so far, or when Wald's sequential probability ratio test
+    // (SPRT) decides it is a bad model. The iteration count adapts to the best inlier ratio,
+    // and the result is refit on its inliers. Results only depend on the seed, not on threads.
+    class horn_ransac
+    {
+    public:
+        // threshold is the inlier distance |Q_i - (r P_i + t)|
+        horn_ransac(double threshold, double confidence = 0.99, int maxIter = 1000, int threads = 1);
+        ~horn_ransac();
+
+        double threshold;
+        double confidence;
+        int maxIter;
+        int threads;
+        int batch;          // hypotheses per parallel batch
+        bool sprt;          // enable SPRT preemption
+        unsigned int seed;
+
+        // Estimates r, t. Returns the number of inliers of the final model, or 0 if fewer than
+        // three correspondences were given or no non-degenerate sample was found.
+        // inliers receives the sorted inlier indices.
+        int estimate(const VecList3f &P, const VecList3f &Q, Quaternion &r, Vec3 *t = NULL, std::vector<int> *inliers = NULL);
+
+        // Hypotheses evaluated by the last estimate()
+        int iterations() const { return iters; }
+
+    private:
+        struct hypothesis
+        {
+            int s[3];
+            Mat3 R;
+            Vec3 t;
+            bool valid;
+            bool rejected;  // preempted before all correspondences were checked
+            int inliers;
+            int checked;
+        };
+
+        size_t n;
+        int iters;
+        std::vector<double> px, py, pz, qx, qy, qz;
+        std::vector<double> w, mask;     // refit weights (current inliers) and candidate inliers
+        std::vector<hypothesis> hyps;
+
+        void solve(hypothesis &h) const;
+        void score(hypothesis &h, int best, double eps, double delta, double logA) const;
+        int classify(const Mat3 &R, const Vec3 &t, double *mask) const;
+        static double sprtThreshold(double eps, double delta);
+    };
+}
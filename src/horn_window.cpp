@@ -0,0 +1,154 @@
+#include "horn_window.h"
+
+#include "horns_alg.hpp"
+
+namespace mg
+{
+    // Squared offset of the mean from the origin, relative to the window variance, above
+    // which the origin is moved to the mean (costing up to two digits in the cross moment)
+    static const double recentreRatio = 1e2;
+
+    horn_window::horn_window(size_t capacity, double forgetting) :
+        capacity(capacity), forgetting(forgetting)
+    {
+        ring.reserve(capacity);
+        clear();
+    }
+
+    horn_window::~horn_window()
+    {
+    }
+
+    void horn_window::push(const Vec3 &p, const Vec3 &q, double w)
+    {
+        if (!origin) {
+            p0 = p;
+            q0 = q;
+            origin = true;
+        }
+
+        tick++;
+        if (forgetting != 1) {
+            sw *= forgetting;
+            sp *= forgetting;
+            sq *= forgetting;
+            spp *= forgetting;
+            sqq *= forgetting;
+            spq *= forgetting;
+        }
+
+        if (capacity > 0)
+        {
+            entry e = { p, q, w, tick };
+            if (ring.size() < capacity)
+                ring.push_back(e);
+            else {
+                entry &old = ring[head];
+                double wOld = forgetting != 1 ? old.w * std::pow(forgetting, (double)(tick - old.tick)) : old.w;
+                accumulate(old.p, old.q, -wOld);
+                n--;
+                old = e;
+                head = (head + 1) % capacity;
+            }
+        }
+
+        accumulate(p, q, w);
+        n++;
+
+        if (sw > 0) {
+            double mp = sp.squaredNorm() / (sw * sw), mq = sq.squaredNorm() / (sw * sw);
+            if (mp > recentreRatio * (spp / sw - mp) || mq > recentreRatio * (sqq / sw - mq))
+                recentre();
+        }
+    }
+
+    void horn_window::remove(const Vec3 &p, const Vec3 &q, double w)
+    {
+        if (n == 0)
+            return;
+
+        accumulate(p, q, -w);
+        n--;
+    }
+
+    void horn_window::clear()
+    {
+        origin = false;
+        p0 = q0 = Vec3::Zero();
+        n = 0;
+        sw = 0;
+        sp = sq = Vec3::Zero();
+        spp = sqq = 0;
+        spq = Mat3::Zero();
+        tick = 0;
+        ring.clear();
+        head = 0;
+    }
+
+    void horn_window::refresh()
+    {
+        if (capacity == 0 || ring.empty())
+            return;
+
+        // Weighted mean of the window, itself taken about the old origin
+        Vec3 mp = Vec3::Zero(), mq = Vec3::Zero();
+        double wsum = 0;
+        for (const entry &e : ring) {
+            double w = forgetting != 1 ? e.w * std::pow(forgetting, (double)(tick - e.tick)) : e.w;
+            mp += w * (e.p - p0);
+            mq += w * (e.q - q0);
+            wsum += w;
+        }
+        if (wsum > 0) {
+            p0 += mp / wsum;
+            q0 += mq / wsum;
+        }
+
+        sw = 0;
+        sp = sq = Vec3::Zero();
+        spp = sqq = 0;
+        spq = Mat3::Zero();
+        for (const entry &e : ring) {
+            double w = forgetting != 1 ? e.w * std::pow(forgetting, (double)(tick - e.tick)) : e.w;
+            accumulate(e.p, e.q, w);
+        }
+    }
+
+    int horn_window::solve(Quaternion &r, Vec3 *t) const
+    {
+        if (n < 3 || sw <= 0)
+            return 0;
+
+        Mat3 S = spq - sp * sq.transpose() / sw;
+        return abs_ori_horn(S, p0 + sp / sw, q0 + sq / sw, r, t);
+    }
+
+    void horn_window::accumulate(const Vec3 &p, const Vec3 &q, double w)
+    {
+        Vec3 wp = w * (p - p0), dq = q - q0;
+        sw += w;
+        sp += wp;
+        sq += w * dq;
+        spq.noalias() += wp * dq.transpose();
+        spp += wp.dot(p - p0);
+        sqq += w * dq.squaredNorm();
+    }
+
+    void horn_window::recentre()
+    {
+        if (capacity > 0) {
+            refresh();
+            return;
+        }
+
+        // Without the window the moments are shifted to the mean in place. This stops the
+        // offset growing but cannot recover digits already lost to it.
+        Vec3 mp = sp / sw, mq = sq / sw;
+        spq -= sp * mq.transpose();
+        spp -= sp.dot(mp);
+        sqq -= sq.dot(mq);
+        p0 += mp;
+        q0 += mq;
+        sp = sq = Vec3::Zero();
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "core.h"
+
+namespace mg
+{
+    // Incremental absolute orientation over a stream of correspondences Q_i ~ r P_i + t.
+    // Keeps the running weighted sums (weight, first moments and the 3x3 cross moment) so
+    // adding or removing a correspondence is O(1), and solve() only needs the 4x4 Horn solve.
+    // Sums are taken relative to an origin near the window mean to limit cancellation; the
+    // origin starts at the first correspondence and moves whenever the mean drifts far from
+    // it compared to the spread of the window.
+    class horn_window
+    {
+    public:
+        // capacity > 0 keeps the last capacity correspondences, dropping the oldest on push.
+        // With forgetting < 1 all weights decay by that factor on every push.
+        horn_window(size_t capacity = 0, double forgetting = 1);
+        ~horn_window();
+
+        void push(const Vec3 &p, const Vec3 &q, double w = 1);
+
+        // Removes a correspondence added with push (with its current, decayed weight).
+        // For windows without a capacity.
+        void remove(const Vec3 &p, const Vec3 &q, double w = 1);
+
+        void clear();
+
+        // Recomputes the sums about the current window mean, discarding accumulated rounding error
+        void refresh();
+
+        // Current rotation and translation. Returns 0 with fewer than three correspondences
+        // or no weight, otherwise as abs_ori_horn.
+        int solve(Quaternion &r, Vec3 *t = NULL) const;
+
+        size_t size() const { return n; }
+        double weight() const { return sw; }
+
+    private:
+        struct entry
+        {
+            Vec3 p, q;
+            double w;
+            long tick;
+        };
+
+        size_t capacity;
+        double forgetting;
+
+        bool origin;
+        Vec3 p0, q0;
+
+        size_t n;
+        double sw;
+        Vec3 sp, sq;
+        double spp, sqq;
+        Mat3 spq;
+
+        long tick;
+        std::vector<entry> ring;
+        size_t head;
+
+        void accumulate(const Vec3 &p, const Vec3 &q, double w);
+        void recentre();
+    };
+}
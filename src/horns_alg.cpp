@@ -13,66 +13,143 @@ using namespace mg::algs;
 
 namespace mg
 {
-    int abs_ori_horn(VecList3f &P, VecList3f &Q,
-                            Quaternion &r, Vec3 *t)
+    int abs_ori_horn(const VecList3f &P, const VecList3f &Q,
+                            Quaternion &r, Vec3 *t, const double *W)
     {
-        Vec3 pbar = mean(P);
-        Vec3 qbar = mean(Q);
-        
-        Mat4 M = Mat4::Zero();
-        for (int i = 0; i < P.size(); i++)
+        size_t n = std::min(P.size(), Q.size());
+        if (n == 0)
+            return 0;
+
+        // One pass over coordinates shifted by the first pair to limit cancellation
+        const Vec3 p0 = P[0], q0 = Q[0];
+        double sw = 0;
+        Vec3 sp = Vec3::Zero(), sq = Vec3::Zero();
+        Mat3 S = Mat3::Zero();
+        for (size_t i = 0; i < n; i++)
         {
-            Vec3 pi = P[i] - pbar, qi = Q[i] - qbar;
-            
-            Mat4 Pi;
-            Pi << 0, -pi(0), -pi(1), -pi(2),
-                pi(0), 0, pi(2), -pi(1),
-                pi(1), -pi(2), 0, pi(0),
-                pi(2), pi(1), -pi(0), 0;
-            
-            Mat4 Qi;
-            Qi << 0, -qi(0), -qi(1), -qi(2),
-                qi(0), 0, -qi(2), qi(1),
-                qi(1), qi(2), 0, -qi(0),
-                qi(2), -qi(1), qi(0), 0;
-            
-            M += Pi.transpose() * Qi;
+            double w = W != NULL ? W[i] : 1.;
+            Vec3 pi = P[i] - p0, qi = Q[i] - q0;
+            sw += w;
+            sp += w * pi;
+            sq += w * qi;
+            S.noalias() += (w * pi) * qi.transpose();
         }
-        
-        Eigen::EigenSolver<Mat4> es(M);
-        if (es.info() != Eigen::Success)
-            return 0 - (int)es.info();
-        
-        // Find largest eigenvalue
-        int max_i = 0;
-        cdouble max_e = es.eigenvalues()[max_i];
-        for (int i = 1; i < 4; i++)
+
+        if (sw <= 0)
+            return 0;
+
+        S -= sp * sq.transpose() / sw;
+        return abs_ori_horn(S, p0 + sp / sw, q0 + sq / sw, r, t);
+    }
+
+    int abs_ori_horn(const double *px, const double *py, const double *pz,
+        const double *qx, const double *qy, const double *qz, size_t n,
+        Quaternion &r, Vec3 *t, const double *W)
+    {
+        using namespace simd;
+
+        if (n == 0)
+            return 0;
+
+        const double p0[3] = { px[0], py[0], pz[0] }, q0[3] = { qx[0], qy[0], qz[0] };
+        const double *ps[3] = { px, py, pz }, *qs[3] = { qx, qy, qz };
+
+        // Accumulators: weight, weighted p (3), weighted q (3), weighted p q^T (9)
+        packd acc[16];
+        for (int k = 0; k < 16; k++)
+            acc[k] = set1(0.);
+
+        packd sp0[3], sq0[3];
+        for (int a = 0; a < 3; a++) {
+            sp0[a] = set1(p0[a]);
+            sq0[a] = set1(q0[a]);
+        }
+
+        size_t i = 0;
+        for (; i + width <= n; i += width)
         {
-            cdouble e = es.eigenvalues()[i];
-            if (e.real() > max_e.real()) {
-                max_e = e;
-                max_i = i;
+            packd w = W != NULL ? load(W + i) : set1(1.);
+            packd p[3], q[3], wp[3];
+            for (int a = 0; a < 3; a++) {
+                p[a] = sub(load(ps[a] + i), sp0[a]);
+                q[a] = sub(load(qs[a] + i), sq0[a]);
+                wp[a] = mul(w, p[a]);
+            }
+
+            acc[0] = add(acc[0], w);
+            for (int a = 0; a < 3; a++) {
+                acc[1 + a] = add(acc[1 + a], wp[a]);
+                acc[4 + a] = fmadd(w, q[a], acc[4 + a]);
+                for (int b = 0; b < 3; b++)
+                    acc[7 + 3 * a + b] = fmadd(wp[a], q[b], acc[7 + 3 * a + b]);
             }
         }
-        
-        if (max_e.imag() > 0)
+
+        double sums[16];
+        for (int k = 0; k < 16; k++)
+            sums[k] = hsum(acc[k]);
+
+        for (; i < n; i++)
+        {
+            double w = W != NULL ? W[i] : 1.;
+            double p[3], q[3];
+            for (int a = 0; a < 3; a++) {
+                p[a] = ps[a][i] - p0[a];
+                q[a] = qs[a][i] - q0[a];
+            }
+
+            sums[0] += w;
+            for (int a = 0; a < 3; a++) {
+                sums[1 + a] += w * p[a];
+                sums[4 + a] += w * q[a];
+                for (int b = 0; b < 3; b++)
+                    sums[7 + 3 * a + b] += w * p[a] * q[b];
+            }
+        }
+
+        double sw = sums[0];
+        if (sw <= 0)
             return 0;
-        
-        mg::Vec<cdouble,4> v = es.eigenvectors().col(max_i);
-        
-        // Eigenvector corresponding to the largest eigenvalue yields
-        // the rotation quaternion from data -> model.
-        // Conjugate gives model -> data, conjugate of that gives the
-        // coordinate transformation. The desired form is the original.
-        r.coeffs()[0] = v[1].real(); // Eigen stores (x,y,z,w)
-        r.coeffs()[1] = v[2].real();
-        r.coeffs()[2] = v[3].real();
-        r.coeffs()[3] = v[0].real();
+
+        Vec3 sp(sums[1], sums[2], sums[3]), sq(sums[4], sums[5], sums[6]);
+        Mat3 S;
+        S << sums[7], sums[8], sums[9],
+            sums[10], sums[11], sums[12],
+            sums[13], sums[14], sums[15];
+        S -= sp * sq.transpose() / sw;
+
+        return abs_ori_horn(S, Vec3(p0[0], p0[1], p0[2]) + sp / sw, Vec3(q0[0], q0[1], q0[2]) + sq / sw, r, t);
+    }
+
+    int abs_ori_horn(const Mat3 &S, const Vec3 &pbar, const Vec3 &qbar, Quaternion &r, Vec3 *t)
+    {
+        double Sxx = S(0, 0), Sxy = S(0, 1), Sxz = S(0, 2);
+        double Syx = S(1, 0), Syy = S(1, 1), Syz = S(1, 2);
+        double Szx = S(2, 0), Szy = S(2, 1), Szz = S(2, 2);
+
+        // Horn's symmetric N matrix, assembled directly from S
+        Mat4 N;
+        N << Sxx + Syy + Szz, Syz - Szy, Szx - Sxz, Sxy - Syx,
+            Syz - Szy, Sxx - Syy - Szz, Sxy + Syx, Szx + Sxz,
+            Szx - Sxz, Sxy + Syx, -Sxx + Syy - Szz, Syz + Szy,
+            Sxy - Syx, Szx + Sxz, Syz + Szy, -Sxx - Syy + Szz;
+
+        Eigen::SelfAdjointEigenSolver<Mat4> es(N);
+        if (es.info() != Eigen::Success)
+            return 0 - (int)es.info();
+
+        // Eigenvector of the largest eigenvalue (sorted ascending) is the rotation
+        // quaternion (w,x,y,z) from data -> model.
+        Vec4 v = es.eigenvectors().col(3);
+        r.coeffs()[0] = v[1]; // Eigen stores (x,y,z,w)
+        r.coeffs()[1] = v[2];
+        r.coeffs()[2] = v[3];
+        r.coeffs()[3] = v[0];
         r.normalize();
-        
+
         if (t != NULL)
             *t = qbar - r.rotate(pbar);
-        
-         return 1;
+
+        return 1;
     }
 }
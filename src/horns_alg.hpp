@@ -12,7 +12,19 @@
 
 namespace mg
 {
-    int abs_ori_horn(VecList3f&, VecList3f&, Quaternion&, Vec3 *t = NULL);
+    // Horn's absolute orientation: finds r, t minimizing sum_i W_i |Q_i - (r P_i + t)|^2
+    // (unit weights if W is NULL). Returns 1 on success, 0 for empty input or zero total
+    // weight, and a negative value if the eigen solver fails.
+    int abs_ori_horn(const VecList3f &P, const VecList3f &Q, Quaternion &r, Vec3 *t = NULL, const double *W = NULL);
+
+    // As above over SoA coordinate arrays of length n, accumulated with SIMD in one pass
+    int abs_ori_horn(const double *px, const double *py, const double *pz,
+        const double *qx, const double *qy, const double *qz, size_t n,
+        Quaternion &r, Vec3 *t = NULL, const double *W = NULL);
+
+    // Solves from the cross-covariance S = sum_i W_i (P_i - pbar)(Q_i - qbar)^T and the
+    // weighted means, via the symmetric 4x4 Horn matrix.
+    int abs_ori_horn(const Mat3 &S, const Vec3 &pbar, const Vec3 &qbar, Quaternion &r, Vec3 *t = NULL);
 }
 
 #endif /* horns_alg_hpp */
@@ -0,0 +1,111 @@
+#include "icp.h"
+
+#include "horns_alg.hpp"
+#include "parallel.h"
+
+#include <algorithm>
+
+namespace mg
+{
+    icp::icp(const VecList3f &target, int threads) :
+        maxIter(50), threads(threads),
+        maxDistance(std::numeric_limits<double>::infinity()), medianRatio(0),
+        angleTol(1e-8), translationTol(1e-8), rmsTol(1e-10),
+        Q(target), tree(target), err(0), nmatched(0), conv(false)
+    {
+    }
+
+    icp::~icp()
+    {
+    }
+
+    int icp::align(const VecList3f &src, Quaternion &r, Vec3 &t)
+    {
+        size_t n = src.size();
+        px.resize(n); py.resize(n); pz.resize(n);
+        qx.resize(n); qy.resize(n); qz.resize(n);
+        w.resize(n); d2.resize(n);
+
+        conv = false;
+        double prevErr = -1;
+
+        int k = 0;
+        while (k < maxIter)
+        {
+            if (match(src, r.toRotationMatrix(), t) < 3)
+                return -1;
+            k++;
+
+            Quaternion rk;
+            Vec3 tk;
+            if (abs_ori_horn(px.data(), py.data(), pz.data(), qx.data(), qy.data(), qz.data(), n, rk, &tk, w.data()) != 1)
+                return -1;
+
+            double dAngle = rk.angularDistance(r), dT = (tk - t).norm();
+            r = rk;
+            t = tk;
+
+            if ((dAngle < angleTol && dT < translationTol) ||
+                (prevErr >= 0 && std::abs(prevErr - err) <= rmsTol * prevErr)) {
+                conv = true;
+                break;
+            }
+            prevErr = err;
+        }
+
+        return k;
+    }
+
+    size_t icp::match(const VecList3f &src, const Mat3 &R, const Vec3 &t)
+    {
+        size_t n = src.size();
+        double maxD2 = maxDistance * maxDistance;
+
+        parallel::forRange(n, threads, [&](size_t begin, size_t end, int) {
+            for (size_t i = begin; i < end; i++)
+            {
+                const Vec3 &p = src[i];
+                int j = tree.nearest(R * p + t, &d2[i], maxD2);
+
+                px[i] = p.x(); py[i] = p.y(); pz[i] = p.z();
+                if (j >= 0) {
+                    qx[i] = Q[j].x(); qy[i] = Q[j].y(); qz[i] = Q[j].z();
+                    w[i] = 1;
+                }
+                else {
+                    qx[i] = px[i]; qy[i] = py[i]; qz[i] = pz[i];
+                    w[i] = 0;
+                }
+            }
+        });
+
+        // Ratio rejection against the median distance of the surviving pairs
+        if (medianRatio > 0)
+        {
+            sorted.clear();
+            for (size_t i = 0; i < n; i++)
+                if (w[i] != 0)
+                    sorted.push_back(d2[i]);
+
+            if (!sorted.empty()) {
+                std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+                double limit = medianRatio * medianRatio * sorted[sorted.size() / 2];
+                for (size_t i = 0; i < n; i++)
+                    if (d2[i] > limit)
+                        w[i] = 0;
+            }
+        }
+
+        nmatched = 0;
+        double sum = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (w[i] != 0) {
+                nmatched++;
+                sum += d2[i];
+            }
+        }
+        err = nmatched > 0 ? std::sqrt(sum / nmatched) : 0;
+
+        return nmatched;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "core.h"
+#include "kd_tree.h"
+
+namespace mg
+{
+    // Point-to-point iterative closest point registration against a fixed target cloud.
+    // The target is indexed once by a kd-tree. Each iteration matches every source point to
+    // its nearest target point in parallel, rejects pairs by absolute distance and by a ratio
+    // to the median pair distance, and solves the pose with the weighted Horn solver.
+    // Buffers are kept across iterations and align() calls.
+    class icp
+    {
+    public:
+        icp(const VecList3f &target, int threads = 1);
+        ~icp();
+
+        int maxIter;
+        int threads;
+        double maxDistance;     // reject pairs farther apart than this
+        double medianRatio;     // reject pairs farther than medianRatio * median distance (0 disables)
+        double angleTol;        // converged when the rotation update (radians)...
+        double translationTol;  // ...and the translation update are both below these,
+        double rmsTol;          // or the relative change in rms error is below this
+
+        // Refines r, t (the initial guess on input) so that target ~ r * src + t.
+        // Returns the number of iterations run, or -1 if fewer than three pairs survived rejection.
+        int align(const VecList3f &src, Quaternion &r, Vec3 &t);
+
+        // Rms distance of the pairs used in the last iteration
+        double rms() const { return err; }
+        size_t matched() const { return nmatched; }
+        bool converged() const { return conv; }
+
+    private:
+        const VecList3f &Q;
+        kd_tree3 tree;
+
+        double err;
+        size_t nmatched;
+        bool conv;
+
+        std::vector<double> px, py, pz, qx, qy, qz, w, d2, sorted;
+
+        size_t match(const VecList3f &src, const Mat3 &R, const Vec3 &t);
+    };
+}
@@ -0,0 +1,106 @@
+#include "kd_tree.h"
+
+#include <algorithm>
+
+namespace mg
+{
+    kd_tree3::kd_tree3()
+    {
+    }
+
+    kd_tree3::kd_tree3(const VecList3f &P)
+    {
+        build(P);
+    }
+
+    kd_tree3::~kd_tree3()
+    {
+    }
+
+    void kd_tree3::build(const VecList3f &P)
+    {
+        idx.resize(P.size());
+        for (size_t i = 0; i < P.size(); i++)
+            idx[i] = (int)i;
+        dim.assign(P.size(), 0);
+
+        build(P, 0, P.size());
+
+        pts.resize(P.size());
+        for (size_t i = 0; i < P.size(); i++)
+            pts[i] = P[idx[i]];
+    }
+
+    void kd_tree3::build(const VecList3f &P, size_t lo, size_t hi)
+    {
+        if (hi - lo <= leafSize)
+            return;
+
+        // Split along the widest extent of the range
+        Vec3 mn = P[idx[lo]], mx = P[idx[lo]];
+        for (size_t i = lo + 1; i < hi; i++) {
+            mn = mn.cwiseMin(P[idx[i]]);
+            mx = mx.cwiseMax(P[idx[i]]);
+        }
+
+        int a;
+        (mx - mn).maxCoeff(&a);
+
+        size_t mid = (lo + hi) / 2;
+        std::nth_element(idx.begin() + lo, idx.begin() + mid, idx.begin() + hi,
+            [&](int i, int j) { return P[i][a] < P[j][a]; });
+
+        dim[mid] = (char)a;
+        build(P, lo, mid);
+        build(P, mid + 1, hi);
+    }
+
+    int kd_tree3::nearest(const Vec3 &q, double *d2, double maxD2) const
+    {
+        int best = -1;
+        double bestD2 = maxD2;
+        if (!pts.empty())
+            search(0, pts.size(), q, best, bestD2);
+
+        if (d2 != NULL)
+            *d2 = bestD2;
+
+        return best;
+    }
+
+    void kd_tree3::search(size_t lo, size_t hi, const Vec3 &q, int &best, double &bestD2) const
+    {
+        if (hi - lo <= leafSize)
+        {
+            for (size_t i = lo; i < hi; i++) {
+                double d2 = (pts[i] - q).squaredNorm();
+                if (d2 < bestD2) {
+                    bestD2 = d2;
+                    best = idx[i];
+                }
+            }
+            return;
+        }
+
+        size_t mid = (lo + hi) / 2;
+        double diff = q[dim[mid]] - pts[mid][dim[mid]];
+
+        double d2 = (pts[mid] - q).squaredNorm();
+        if (d2 < bestD2) {
+            bestD2 = d2;
+            best = idx[mid];
+        }
+
+        // Near side first, far side only if the splitting plane is within reach
+        if (diff < 0) {
+            search(lo, mid, q, best, bestD2);
+            if (diff * diff < bestD2)
+                search(mid + 1, hi, q, best, bestD2);
+        }
+        else {
+            search(mid + 1, hi, q, best, bestD2);
+            if (diff * diff < bestD2)
+                search(lo, mid, q, best, bestD2);
+        }
+    }
+}
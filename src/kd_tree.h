@@ -0,0 +1,37 @@
+#pragma once
+
+#include "core.h"
+
+#include <limits>
+
+namespace mg
+{
+    // Static kd-tree over 3D points for nearest neighbour queries. The tree is implicit:
+    // points are permuted so that each range [lo, hi) splits at its median, with buckets
+    // of up to leafSize points at the bottom, so it is two flat arrays with no nodes.
+    class kd_tree3
+    {
+    public:
+        kd_tree3();
+        kd_tree3(const VecList3f &P);
+        ~kd_tree3();
+
+        void build(const VecList3f &P);
+
+        // Index into P of the point nearest to q within sqrt(maxD2), or -1 if there is none.
+        // d2 receives its squared distance.
+        int nearest(const Vec3 &q, double *d2 = NULL, double maxD2 = std::numeric_limits<double>::infinity()) const;
+
+        size_t size() const { return pts.size(); }
+
+    private:
+        static const size_t leafSize = 8;
+
+        VecList3f pts;          // points in tree order
+        std::vector<int> idx;   // index in P of each point in tree order
+        std::vector<char> dim;  // split axis of the range whose median is at i
+
+        void build(const VecList3f &P, size_t lo, size_t hi);
+        void search(size_t lo, size_t hi, const Vec3 &q, int &best, double &bestD2) const;
+    };
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "core.h"
+
+namespace mg
+{
+    // Running mean and covariance of Vec<double,N> samples (Welford's update), with
+    // optional weights. Two accumulators merge exactly (Chan et al.), so statistics can be
+    // gathered per stream or per thread in one pass and combined without the samples.
+    template <int N>
+    class running_moments
+    {
+    public:
+        typedef Vec<double, N> Vector;
+        typedef Mat<double, N, N> Matrix;
+
+        running_moments() { clear(); }
+
+        void clear()
+        {
+            n = 0;
+            w = 0;
+            mu.setZero();
+            M2.setZero();
+        }
+
+        void push(const Vector &x)
+        {
+            n++;
+            w += 1;
+            Vector d = x - mu;
+            mu += d / w;
+            M2.noalias() += d * (x - mu).transpose();
+        }
+
+        void push(const Vector &x, double wx)
+        {
+            if (wx <= 0)
+                return;
+
+            n++;
+            w += wx;
+            Vector d = x - mu;
+            mu += (wx / w) * d;
+            M2.noalias() += wx * d * (x - mu).transpose();
+        }
+
+        void merge(const running_moments &o)
+        {
+            if (o.w <= 0)
+                return;
+            if (w <= 0) {
+                *this = o;
+                return;
+            }
+
+            double W = w + o.w;
+            Vector d = o.mu - mu;
+            mu += (o.w / W) * d;
+            M2 += o.M2 + (w * o.w / W) * d * d.transpose();
+            w = W;
+            n += o.n;
+        }
+
+        size_t count() const { return n; }
+        double weight() const { return w; }
+        const Vector& mean() const { return mu; }
+
+        // Population covariance sum w (x - mean)(x - mean)^T / sum w
+        Matrix cov() const { return w > 0 ? Matrix(M2 / w) : Matrix(Matrix::Zero()); }
+
+        // Unbiased covariance, for unit weights
+        Matrix sampleCov() const { return w > 1 ? Matrix(M2 / (w - 1)) : Matrix(Matrix::Zero()); }
+
+    private:
+        size_t n;
+        double w;
+        Vector mu;
+        Matrix M2;  // sum w (x - mean)(x - mean)^T
+    };
+
+    // Running means and cross-covariance of paired Vec<double,N>, Vec<double,M> streams
+    template <int N, int M>
+    class running_cross_moments
+    {
+    public:
+        typedef Vec<double, N> VectorX;
+        typedef Vec<double, M> VectorY;
+        typedef Mat<double, N, M> Matrix;
+
+        running_cross_moments() { clear(); }
+
+        void clear()
+        {
+            n = 0;
+            w = 0;
+            mx.setZero();
+            my.setZero();
+            C.setZero();
+        }
+
+        void push(const VectorX &x, const VectorY &y, double wx = 1)
+        {
+            if (wx <= 0)
+                return;
+
+            n++;
+            w += wx;
+            VectorX dx = x - mx;
+            mx += (wx / w) * dx;
+            my += (wx / w) * (y - my);
+            C.noalias() += wx * dx * (y - my).transpose();
+        }
+
+        void merge(const running_cross_moments &o)
+        {
+            if (o.w <= 0)
+                return;
+            if (w <= 0) {
+                *this = o;
+                return;
+            }
+
+            double W = w + o.w;
+            VectorX dx = o.mx - mx;
+            VectorY dy = o.my - my;
+            mx += (o.w / W) * dx;
+            my += (o.w / W) * dy;
+            C += o.C + (w * o.w / W) * dx * dy.transpose();
+            w = W;
+            n += o.n;
+        }
+
+        size_t count() const { return n; }
+        double weight() const { return w; }
+        const VectorX& meanX() const { return mx; }
+        const VectorY& meanY() const { return my; }
+
+        // Population cross-covariance sum w (x - mean x)(y - mean y)^T / sum w
+        Matrix cov() const { return w > 0 ? Matrix(C / w) : Matrix(Matrix::Zero()); }
+
+        // Unbiased cross-covariance, for unit weights
+        Matrix sampleCov() const { return w > 1 ? Matrix(C / (w - 1)) : Matrix(Matrix::Zero()); }
+
+    private:
+        size_t n;
+        double w;
+        VectorX mx;
+        VectorY my;
+        Matrix C;   // sum w (x - mean x)(y - mean y)^T
+    };
+}
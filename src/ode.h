@@ -0,0 +1,410 @@
+#pragma once
+
+#include "core.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace mg
+{
+    namespace algs
+    {
+        // Fourth-order Runge-Kutta over [t0, t1] in a fixed number of steps.
+        // f is any callable T f(double t, const T &y) returning dy/dt. Other f (such as the
+        // fn_rk4 pointers of the variadic rk4 in algs.h) don't take part in overloading.
+        template<typename T, typename F, typename = decltype(std::declval<F&>()(0.0, std::declval<const T&>()))>
+        T rk4(F f, const T &y0, double t0, double t1, int steps)
+        {
+            double h = (t1 - t0) / steps;
+            T k1(y0), k2(y0), k3(y0), k4(y0), yn(y0);
+
+            for (int i = 0; i < steps; i++)
+            {
+                double t = t0 + i * h;
+                k1 = f(t, yn);
+                k2 = f(t + h / 2, yn + (h / 2)*k1);
+                k3 = f(t + h / 2, yn + (h / 2)*k2);
+                k4 = f(t + h, yn + h * k3);
+                yn += (h / 6)*(k1 + 2 * k2 + 2 * k3 + k4);
+            }
+
+            return yn;
+        }
+
+        namespace detail
+        {
+            // Dormand-Prince 5(4) tableau, error weights (b - b*) and dense output weights
+            namespace dopri
+            {
+                const double c2 = 1. / 5, c3 = 3. / 10, c4 = 4. / 5, c5 = 8. / 9;
+                const double a21 = 1. / 5;
+                const double a31 = 3. / 40, a32 = 9. / 40;
+                const double a41 = 44. / 45, a42 = -56. / 15, a43 = 32. / 9;
+                const double a51 = 19372. / 6561, a52 = -25360. / 2187, a53 = 64448. / 6561, a54 = -212. / 729;
+                const double a61 = 9017. / 3168, a62 = -355. / 33, a63 = 46732. / 5247, a64 = 49. / 176, a65 = -5103. / 18656;
+                const double b1 = 35. / 384, b3 = 500. / 1113, b4 = 125. / 192, b5 = -2187. / 6784, b6 = 11. / 84;
+                const double e1 = 71. / 57600, e3 = -71. / 16695, e4 = 71. / 1920, e5 = -17253. / 339200, e6 = 22. / 525, e7 = -1. / 40;
+                const double d1 = -12715105075. / 11282082432, d3 = 87487479700. / 32700410799, d4 = -10690763975. / 1880347072,
+                    d5 = 701980252875. / 199316789632, d6 = -1453857185. / 822651844, d7 = 69997945. / 29380423;
+            }
+        }
+
+        // Adaptive Dormand-Prince 5(4) integrator with dense output.
+        // T is an Eigen column vector (e.g. Vec<double,N> or VecX) and f any callable
+        // T f(double t, const T &y) returning dy/dt. Stage buffers are members sized from
+        // the prototype state, so stepping fixed-size states never touches the heap.
+        template<typename T>
+        class rk45
+        {
+        public:
+            double rtol, atol;
+            double hmin, hmax;
+            int maxSteps;
+
+            rk45(const T &proto = T(), double rtol = 1e-6, double atol = 1e-9)
+                : rtol(rtol), atol(atol), hmin(1e-12), hmax(std::numeric_limits<double>::infinity()),
+                maxSteps(100000), h(0), told(0), hlast(0), fsal(false), k1valid(false),
+                k1(proto), k2(proto), k3(proto), k4(proto), k5(proto), k6(proto), k7(proto),
+                yt(proto), ynew(proto), yold(proto)
+            {}
+
+            // Forget the step size and cached derivative, e.g. before integrating a new trajectory
+            void reset(double h0 = 0) { h = h0; fsal = k1valid = false; }
+
+            // Current (next attempted) step size
+            double stepSize() const { return h; }
+
+            // Integrates y from t to t1. Returns the number of accepted steps, or -1 if the
+            // step size fell below hmin or maxSteps was exceeded (t, y hold the last accepted state).
+            template<typename F>
+            int integrate(F f, double &t, T &y, double t1)
+            {
+                int n = 0;
+                while (t != t1)
+                {
+                    if (n >= maxSteps || !step(f, t, y, t1))
+                        return -1;
+                    n++;
+                }
+                return n;
+            }
+
+            // Takes one accepted step from t towards t1, retrying with smaller steps as needed.
+            // Returns false if the step size fell below hmin.
+            template<typename F>
+            bool step(F f, double &t, T &y, double t1)
+            {
+                using namespace detail::dopri;
+
+                // First-same-as-last: the last stage of the previous step is this step's first
+                if (fsal)
+                    k1 = k7;
+                else if (!k1valid)
+                    k1 = f(t, y);
+                fsal = false;
+                k1valid = true;
+
+                if (h <= 0)
+                    h = initialStep(t, y, t1);
+
+                double dir = t1 < t ? -1. : 1.;
+                for (;;)
+                {
+                    double span = std::abs(t1 - t);
+                    bool last = h >= span;
+                    double hs = dir * (last ? span : h);
+
+                    yt = y + hs * (a21 * k1);
+                    k2 = f(t + c2 * hs, yt);
+                    yt = y + hs * (a31 * k1 + a32 * k2);
+                    k3 = f(t + c3 * hs, yt);
+                    yt = y + hs * (a41 * k1 + a42 * k2 + a43 * k3);
+                    k4 = f(t + c4 * hs, yt);
+                    yt = y + hs * (a51 * k1 + a52 * k2 + a53 * k3 + a54 * k4);
+                    k5 = f(t + c5 * hs, yt);
+                    yt = y + hs * (a61 * k1 + a62 * k2 + a63 * k3 + a64 * k4 + a65 * k5);
+                    k6 = f(t + hs, yt);
+                    ynew = y + hs * (b1 * k1 + b3 * k3 + b4 * k4 + b5 * k5 + b6 * k6);
+                    double tn = last ? t1 : t + hs;
+                    k7 = f(tn, ynew);
+
+                    // Embedded 4th order error estimate, RMS-scaled by the tolerances
+                    yt = hs * (e1 * k1 + e3 * k3 + e4 * k4 + e5 * k5 + e6 * k6 + e7 * k7);
+                    double err = (yt.array() / (atol + rtol * y.array().abs().max(ynew.array().abs())))
+                        .matrix().norm() / std::sqrt(double(std::max<Eigen::Index>(y.size(), 1)));
+
+                    if (err <= 1.)
+                    {
+                        double fac = err == 0. ? 10. : std::min(10., std::max(0.2, 0.9 * std::pow(err, -0.2)));
+                        h = std::min(hmax, std::abs(hs) * fac);
+                        told = t;
+                        hlast = hs;
+                        yold = y;
+                        t = tn;
+                        y = ynew;
+                        fsal = true;
+                        return true;
+                    }
+
+                    h = std::abs(hs) * std::max(0.2, 0.9 * std::pow(err, -0.2));
+                    if (h < hmin)
+                        return false;
+                }
+            }
+
+            // Dense output: evaluates the 4th order continuous extension of the last accepted
+            // step at time t in [told, told + hlast].
+            void interpolate(double t, T &out) const
+            {
+                using namespace detail::dopri;
+
+                double th = hlast == 0. ? 1. : (t - told) / hlast;
+                double th1 = 1. - th;
+                out = yold + th * ((ynew - yold) + th1 * ((hlast * k1 - (ynew - yold))
+                    + th * ((2. * (ynew - yold) - hlast * (k1 + k7))
+                        + th1 * (hlast * (d1 * k1 + d3 * k3 + d4 * k4 + d5 * k5 + d6 * k6 + d7 * k7)))));
+            }
+
+            // Time span [told, told + hlast] covered by the last accepted step
+            double lastTime() const { return told; }
+            double lastStep() const { return hlast; }
+
+        private:
+            double h, told, hlast;
+            bool fsal, k1valid;
+            T k1, k2, k3, k4, k5, k6, k7;
+            T yt, ynew, yold;
+
+            double initialStep(double t, const T &y, double t1)
+            {
+                double d0 = (y.array() / (atol + rtol * y.array().abs())).matrix().norm();
+                double d1 = (k1.array() / (atol + rtol * y.array().abs())).matrix().norm();
+                double h0 = (d0 < 1e-5 || d1 < 1e-5) ? 1e-6 : 0.01 * d0 / d1;
+                return std::min(std::min(h0, hmax), std::abs(t1 - t));
+            }
+        };
+
+        // Adapts a per-trajectory callable Vec<double,N> g(double t, const Vec<double,N> &y)
+        // to the lane-block interface of ensemble_rk45.
+        template<int N, typename G>
+        struct lanewise_fn
+        {
+            G g;
+
+            template<typename TT, typename YT, typename DT>
+            void operator()(const TT &t, const YT &y, DT dydt) const
+            {
+                for (Eigen::Index l = 0; l < y.cols(); l++)
+                    dydt.col(l) = g(t(l), Vec<double, N>(y.col(l).matrix())).array();
+            }
+        };
+
+        template<int N, typename G>
+        lanewise_fn<N, G> lanewise(G g)
+        {
+            return lanewise_fn<N, G>{ g };
+        }
+
+        // Integrates many trajectories of an N-dimensional system in parallel, each with its
+        // own adaptive Dormand-Prince step size. Every worker thread keeps a block of lanes stored
+        // component-major (row i holds component i of every lane) so that the stage arithmetic
+        // vectorizes across trajectories. Finished lanes are refilled from the shared batch,
+        // so long-lived trajectories don't hold up the others.
+        //
+        // The derivative is evaluated for a block of lanes at once as f(t, y, dydt) with
+        //   const Eigen::Ref<const Times> &t, const Eigen::Ref<const Lanes> &y, Eigen::Ref<Lanes> dydt
+        // (see lanewise() to wrap a per-trajectory callable).
+        template<int N>
+        class ensemble_rk45
+        {
+        public:
+            typedef Vec<double, N> State;
+            typedef Eigen::Array<double, N, Eigen::Dynamic, Eigen::RowMajor> Lanes;
+            typedef Eigen::Array<double, 1, Eigen::Dynamic> Times;
+
+            double rtol, atol;
+            double hmin, hmax;
+            int maxSteps;
+            int threads;
+            int lanes;
+
+            ensemble_rk45(double rtol = 1e-6, double atol = 1e-9, int threads = 0, int lanes = 64)
+                : rtol(rtol), atol(atol), hmin(1e-12), hmax(std::numeric_limits<double>::infinity()),
+                maxSteps(100000), threads(threads), lanes(lanes)
+            {}
+
+            // Integrates every state in Y from t0 to t1 in place. If given, steps receives the number
+            // of accepted steps per trajectory (-1 on failure) and tEnd the time each one stopped at.
+            template<typename F>
+            void integrate(F f, EigList<State> &Y, double t0, double t1,
+                std::vector<int> *steps = NULL, std::vector<double> *tEnd = NULL)
+            {
+                integrateUntil(f, Y, t0, t1, [](double, const State &) { return false; }, steps, tEnd);
+            }
+
+            // As integrate(), but a trajectory also stops after the first accepted step for which
+            // stop(t, y) returns true.
+            template<typename F, typename S>
+            void integrateUntil(F f, EigList<State> &Y, double t0, double t1, S stop,
+                std::vector<int> *steps = NULL, std::vector<double> *tEnd = NULL)
+            {
+                if (steps != NULL) steps->assign(Y.size(), 0);
+                if (tEnd != NULL) tEnd->assign(Y.size(), t0);
+
+                std::atomic<size_t> next(0);
+                size_t B = (size_t)std::max(lanes, 1);
+                size_t nblocks = (Y.size() + B - 1) / B;
+                int nthreads = (int)std::min<size_t>(parallel::threadCount(threads), std::max<size_t>(nblocks, 1));
+
+                parallel::run(nthreads, [&](int) {
+                    worker(f, stop, Y, t0, t1, next, steps, tEnd);
+                });
+            }
+
+        private:
+            template<typename F, typename S>
+            void worker(F &f, S &stop, EigList<State> &Y, double t0, double t1, std::atomic<size_t> &next,
+                std::vector<int> *steps, std::vector<double> *tEnd)
+            {
+                using namespace detail::dopri;
+
+                const int B = std::max(lanes, 1);
+                const size_t count = Y.size();
+                const double dir = t1 < t0 ? -1. : 1.;
+
+                Lanes y(N, B), yt(N, B), ynew(N, B), sc(N, B);
+                Lanes k1(N, B), k2(N, B), k3(N, B), k4(N, B), k5(N, B), k6(N, B), k7(N, B);
+                Times t(B), tt(B), h(B), hs(B), err(B);
+                std::vector<size_t> idx(B);
+                std::vector<int> nsteps(B), state(B);
+
+                int m = 0;
+                for (;;)
+                {
+                    // Refill free lanes from the batch
+                    int m0 = m;
+                    if (m < B)
+                    {
+                        size_t begin = next.fetch_add(B - m);
+                        for (size_t i = begin; i < count && m < B; i++, m++)
+                        {
+                            y.col(m) = Y[i].array();
+                            t(m) = t0;
+                            idx[m] = i;
+                            nsteps[m] = 0;
+                            state[m] = 0;
+                        }
+                    }
+                    if (m == 0)
+                        break;
+
+                    if (m > m0)
+                    {
+                        int n = m - m0;
+                        f(t.segment(m0, n), y.middleCols(m0, n), k1.middleCols(m0, n));
+
+                        // Initial step sizes
+                        sc.middleCols(m0, n) = atol + rtol * y.middleCols(m0, n).abs();
+                        for (int l = m0; l < m; l++)
+                        {
+                            double d0 = (y.col(l) / sc.col(l)).matrix().norm();
+                            double d1 = (k1.col(l) / sc.col(l)).matrix().norm();
+                            double h0 = (d0 < 1e-5 || d1 < 1e-5) ? 1e-6 : 0.01 * d0 / d1;
+                            h(l) = std::min(std::min(h0, hmax), std::abs(t1 - t0));
+                        }
+                    }
+
+                    // One Dormand-Prince attempt on every active lane
+                    hs.head(m) = dir * h.head(m).min((t1 - t.head(m)).abs());
+
+                    yt.leftCols(m) = y.leftCols(m) + (a21 * k1.leftCols(m)).rowwise() * hs.head(m);
+                    tt.head(m) = t.head(m) + c2 * hs.head(m);
+                    f(tt.head(m), yt.leftCols(m), k2.leftCols(m));
+
+                    yt.leftCols(m) = y.leftCols(m) + (a31 * k1.leftCols(m) + a32 * k2.leftCols(m)).rowwise() * hs.head(m);
+                    tt.head(m) = t.head(m) + c3 * hs.head(m);
+                    f(tt.head(m), yt.leftCols(m), k3.leftCols(m));
+
+                    yt.leftCols(m) = y.leftCols(m) + (a41 * k1.leftCols(m) + a42 * k2.leftCols(m)
+                        + a43 * k3.leftCols(m)).rowwise() * hs.head(m);
+                    tt.head(m) = t.head(m) + c4 * hs.head(m);
+                    f(tt.head(m), yt.leftCols(m), k4.leftCols(m));
+
+                    yt.leftCols(m) = y.leftCols(m) + (a51 * k1.leftCols(m) + a52 * k2.leftCols(m)
+                        + a53 * k3.leftCols(m) + a54 * k4.leftCols(m)).rowwise() * hs.head(m);
+                    tt.head(m) = t.head(m) + c5 * hs.head(m);
+                    f(tt.head(m), yt.leftCols(m), k5.leftCols(m));
+
+                    yt.leftCols(m) = y.leftCols(m) + (a61 * k1.leftCols(m) + a62 * k2.leftCols(m)
+                        + a63 * k3.leftCols(m) + a64 * k4.leftCols(m) + a65 * k5.leftCols(m)).rowwise() * hs.head(m);
+                    tt.head(m) = t.head(m) + hs.head(m);
+                    f(tt.head(m), yt.leftCols(m), k6.leftCols(m));
+
+                    ynew.leftCols(m) = y.leftCols(m) + (b1 * k1.leftCols(m) + b3 * k3.leftCols(m)
+                        + b4 * k4.leftCols(m) + b5 * k5.leftCols(m) + b6 * k6.leftCols(m)).rowwise() * hs.head(m);
+                    f(tt.head(m), ynew.leftCols(m), k7.leftCols(m));
+
+                    yt.leftCols(m) = (e1 * k1.leftCols(m) + e3 * k3.leftCols(m) + e4 * k4.leftCols(m)
+                        + e5 * k5.leftCols(m) + e6 * k6.leftCols(m) + e7 * k7.leftCols(m)).rowwise() * hs.head(m);
+                    sc.leftCols(m) = atol + rtol * y.leftCols(m).abs().max(ynew.leftCols(m).abs());
+                    err.head(m) = ((yt.leftCols(m) / sc.leftCols(m)).square().colwise().sum() / double(N)).sqrt();
+
+                    // Per-lane step control
+                    for (int l = 0; l < m; l++)
+                    {
+                        double e = err(l), hsl = std::abs(hs(l));
+                        if (e <= 1.)
+                        {
+                            double fac = e == 0. ? 10. : std::min(10., std::max(0.2, 0.9 * std::pow(e, -0.2)));
+                            bool last = hsl >= std::abs(t1 - t(l));
+                            h(l) = std::min(hmax, hsl * fac);
+                            t(l) = last ? t1 : t(l) + hs(l);
+                            y.col(l) = ynew.col(l);
+                            k1.col(l) = k7.col(l);
+                            nsteps[l]++;
+
+                            if (last || stop(t(l), State(y.col(l).matrix())))
+                                state[l] = 1;
+                            else if (nsteps[l] >= maxSteps)
+                                state[l] = 2;
+                        }
+                        else
+                        {
+                            h(l) = hsl * std::max(0.2, 0.9 * std::pow(e, -0.2));
+                            if (h(l) < hmin)
+                                state[l] = 2;
+                        }
+                    }
+
+                    // Write out finished lanes, compacting the active ones to the front
+                    for (int l = 0; l < m;)
+                    {
+                        if (state[l] == 0) {
+                            l++;
+                            continue;
+                        }
+
+                        size_t i = idx[l];
+                        Y[i] = y.col(l).matrix();
+                        if (steps != NULL) (*steps)[i] = state[l] == 1 ? nsteps[l] : -1;
+                        if (tEnd != NULL) (*tEnd)[i] = t(l);
+
+                        m--;
+                        if (l != m)
+                        {
+                            y.col(l) = y.col(m);
+                            k1.col(l) = k1.col(m);
+                            t(l) = t(m);
+                            h(l) = h(m);
+                            idx[l] = idx[m];
+                            nsteps[l] = nsteps[m];
+                            state[l] = state[m];
+                        }
+                    }
+                }
+            }
+        };
+    }
+}
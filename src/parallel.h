@@ -0,0 +1,165 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mg
+{
+    namespace parallel
+    {
+        // Number of worker threads to use for a requested count (<= 0: hardware concurrency)
+        inline int threadCount(int requested = 0)
+        {
+            if (requested > 0)
+                return requested;
+            int hw = (int)std::thread::hardware_concurrency();
+            return hw > 0 ? hw : 1;
+        }
+
+        namespace detail
+        {
+            // Persistent workers behind run(), started on first use and grown to the largest
+            // number of threads requested, so repeated calls don't pay for thread start-up.
+            class pool
+            {
+            public:
+                static pool& instance()
+                {
+                    static pool p;
+                    return p;
+                }
+
+                // True on pool workers, where nested run() calls execute inline
+                static bool& inWorker()
+                {
+                    static thread_local bool w = false;
+                    return w;
+                }
+
+                ~pool()
+                {
+                    {
+                        std::lock_guard<std::mutex> l(m);
+                        stop = true;
+                    }
+                    cv.notify_all();
+                    for (auto &w : workers)
+                        w.join();
+                }
+
+                void reserve(size_t n)
+                {
+                    std::lock_guard<std::mutex> l(m);
+                    while (workers.size() < n)
+                        workers.emplace_back([this]() { work(); });
+                }
+
+                void submit(std::function<void()> task)
+                {
+                    {
+                        std::lock_guard<std::mutex> l(m);
+                        tasks.push_back(std::move(task));
+                    }
+                    cv.notify_one();
+                }
+
+            private:
+                std::mutex m;
+                std::condition_variable cv;
+                std::deque<std::function<void()> > tasks;
+                std::vector<std::thread> workers;
+                bool stop = false;
+
+                pool() {}
+
+                void work()
+                {
+                    inWorker() = true;
+                    for (;;)
+                    {
+                        std::function<void()> task;
+                        {
+                            std::unique_lock<std::mutex> l(m);
+                            cv.wait(l, [this]() { return stop || !tasks.empty(); });
+                            if (tasks.empty())
+                                return;
+                            task = std::move(tasks.front());
+                            tasks.pop_front();
+                        }
+                        task();
+                    }
+                }
+            };
+        }
+
+        // Runs f(thread) on threads workers, the calling thread being worker 0 and the others
+        // taken from a persistent pool. Nested calls from a pool worker run inline.
+        template<typename F>
+        void run(int threads, F f)
+        {
+            threads = threadCount(threads);
+            if (threads == 1 || detail::pool::inWorker()) {
+                for (int i = 0; i < threads; i++)
+                    f(i);
+                return;
+            }
+
+            detail::pool &p = detail::pool::instance();
+            p.reserve(threads - 1);
+
+            std::mutex m;
+            std::condition_variable done;
+            int remaining = threads - 1;
+            for (int i = 1; i < threads; i++) {
+                p.submit([&, i]() {
+                    f(i);
+                    std::lock_guard<std::mutex> l(m);
+                    if (--remaining == 0)
+                        done.notify_one();
+                });
+            }
+
+            f(0);
+
+            std::unique_lock<std::mutex> l(m);
+            done.wait(l, [&]() { return remaining == 0; });
+        }
+
+        // Calls f(begin, end, thread) over n items split into one contiguous range per thread.
+        // The partition only depends on n and threads.
+        template<typename F>
+        void forRange(size_t n, int threads, F f)
+        {
+            threads = (int)std::min<size_t>(threadCount(threads), std::max<size_t>(n, 1));
+            run(threads, [&](int k) {
+                size_t begin = n * k / threads, end = n * (k + 1) / threads;
+                if (begin < end)
+                    f(begin, end, k);
+            });
+        }
+
+        // Calls f(begin, end, thread) over n items handed out dynamically in chunks,
+        // for work whose cost varies per item.
+        template<typename F>
+        void forChunks(size_t n, int threads, size_t chunk, F f)
+        {
+            chunk = std::max<size_t>(chunk, 1);
+            threads = (int)std::min<size_t>(threadCount(threads), (n + chunk - 1) / chunk);
+            std::atomic<size_t> next(0);
+            run(std::max(threads, 1), [&](int k) {
+                for (;;) {
+                    size_t begin = next.fetch_add(chunk);
+                    if (begin >= n)
+                        break;
+                    f(begin, std::min(begin + chunk, n), k);
+                }
+            });
+        }
+    }
+}
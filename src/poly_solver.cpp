@@ -0,0 +1,227 @@
+#include "poly_solver.h"
+
+#include "algs.h"
+
+#include <limits>
+
+namespace mg
+{
+    poly_solver::poly_solver(int n, int maxIter, double tol)
+        : n(n), maxIter(maxIter), tol(tol), a(n + 1), z(n), done(n), C(n, n), es(n)
+    {
+    }
+
+    poly_solver::~poly_solver()
+    {
+    }
+
+    int poly_solver::Solve(const double *coeffs, int n, cdouble *solns)
+    {
+        return poly_solver(n).solve(coeffs, solns);
+    }
+
+    int poly_solver::solve(const double *coeffs, cdouble *solns)
+    {
+        // Leading zero coefficients drop to the lower degree, leaving NaN in the unused slots
+        // as the closed forms do (which handle their own leading zeros)
+        int m = n;
+        if (n > 4)
+        {
+            while (m > 0 && coeffs[n - m] == 0.)
+                m--;
+            for (int i = m; i < n; i++)
+                solns[i] = std::numeric_limits<double>::quiet_NaN();
+            coeffs += n - m;
+        }
+
+        switch (m)
+        {
+        case 0:
+            return 0;
+        case 1:
+            if (coeffs[0] == 0.) {
+                solns[0] = std::numeric_limits<double>::quiet_NaN();
+                return 0;
+            }
+            solns[0] = -coeffs[1] / coeffs[0];
+            return 1;
+        case 2:
+        {
+            int nr;
+            double r[2];
+            algs::solveQuadratic(coeffs, coeffs + 1, coeffs + 2, 1, &nr, r, 1, solns);
+            return nr;
+        }
+        case 3:
+        {
+            int nr;
+            double r[3];
+            algs::solveCubic(coeffs, coeffs + 1, coeffs + 2, coeffs + 3, 1, &nr, r, 2, solns);
+            return nr;
+        }
+        case 4:
+            return algs::solveQuartic(coeffs[0], coeffs[1], coeffs[2], coeffs[3], coeffs[4], solns);
+        }
+
+        // Work on the monic polynomial
+        for (int i = 0; i <= m; i++)
+            a(i) = coeffs[i] / coeffs[0];
+
+        int res = aberth(solns, m, false);
+        if (res < 0)
+            res = companion(solns, m);
+
+        return res;
+    }
+
+    void poly_solver::solve(const double *coeffs, size_t count, cdouble *solns, int *nreal, bool warmStart)
+    {
+        for (size_t k = 0; k < count; k++)
+        {
+            const double *ck = coeffs + k * (n + 1);
+            cdouble *sk = solns + k * n;
+            int res;
+
+            if (n > 4 && warmStart && k > 0 && ck[0] != 0.)
+            {
+                for (int i = 0; i <= n; i++)
+                    a(i) = ck[i] / ck[0];
+                for (int i = 0; i < n; i++)
+                    sk[i] = sk[i - n];
+
+                res = aberth(sk, n, true);
+                if (res < 0)
+                    res = companion(sk, n);
+            }
+            else
+                res = solve(ck, sk);
+
+            if (nreal != NULL)
+                nreal[k] = res;
+        }
+    }
+
+    int poly_solver::aberth(cdouble *solns, int m, bool seeded)
+    {
+        for (int i = 0; i < m && seeded; i++)
+            seeded = std::isfinite(solns[i].real()) && std::isfinite(solns[i].imag());
+
+        if (seeded)
+        {
+            // Nudge the seeds off the real axis (alternately up and down): from real seeds the
+            // iteration stays real and can't follow a real pair that has turned complex
+            for (int i = 0; i < m; i++)
+                z(i) = solns[i] + cdouble(0., (i % 2 ? -1e-6 : 1e-6) * (1. + std::abs(solns[i])));
+        }
+        else
+        {
+            // Start on a circle about the centroid of the roots with radius from the Fujiwara bound
+            double R = 0;
+            for (int k = 1; k <= m; k++)
+                R = std::max(R, pow(std::abs(a(k)), 1. / k));
+            cdouble c = -a(1) / double(m);
+            for (int i = 0; i < m; i++)
+                z(i) = c + R * std::polar(1., 2. * M_PI * i / m + 0.4);
+        }
+
+        done.setConstant(false);
+        int remaining = m;
+        for (int it = 0; it < maxIter && remaining > 0; it++)
+        {
+            for (int i = 0; i < m; i++)
+            {
+                if (done(i))
+                    continue;
+
+                // p(z) and p'(z) by Horner, with the rounding error bound of p
+                cdouble zi = z(i), p = a(0), dp = 0.;
+                double az = std::abs(zi), bound = std::abs(a(0));
+                for (int k = 1; k <= m; k++) {
+                    dp = dp * zi + p;
+                    p = p * zi + a(k);
+                    bound = bound * az + std::abs(a(k));
+                }
+
+                // Nothing left to gain once p is rounding noise (as for roots near 0 or
+                // clustered ones, where the relative step can't reach tol)
+                if (std::abs(p) <= 4 * std::numeric_limits<double>::epsilon() * bound) {
+                    done(i) = true;
+                    remaining--;
+                    continue;
+                }
+
+                cdouble ratio = p / dp;
+                cdouble sum = 0.;
+                for (int j = 0; j < m; j++)
+                    if (j != i)
+                        sum += 1. / (zi - z(j));
+
+                cdouble w = ratio / (1. - ratio * sum);
+                if (!std::isfinite(w.real()) || !std::isfinite(w.imag()))
+                    return -1;
+
+                z(i) = zi - w;
+                if (std::abs(w) <= tol * std::abs(z(i))) {
+                    done(i) = true;
+                    remaining--;
+                }
+            }
+        }
+
+        if (remaining > 0)
+            return -1;
+
+        for (int i = 0; i < m; i++)
+            solns[i] = z(i);
+
+        return countReal(solns, m);
+    }
+
+    int poly_solver::companion(cdouble *solns, int m)
+    {
+        // Below degree n the companion matrix sits in the top left corner, so the solver
+        // keeps its size and the zero block adds n - m zero eigenvalues, dropped below
+        C.setZero();
+        for (int j = 0; j < m; j++)
+            C(0, j) = -a(j + 1);
+        for (int i = 1; i < m; i++)
+            C(i, i - 1) = 1.;
+
+        es.compute(C, false);
+        if (es.info() != Eigen::Success)
+            return -1;
+
+        for (int i = 0; i < n; i++)
+            z(i) = es.eigenvalues()[i];
+
+        done.setConstant(false);
+        for (int k = m; k < n; k++)
+        {
+            int imin = -1;
+            for (int i = 0; i < n; i++)
+                if (!done(i) && (imin < 0 || std::abs(z(i)) < std::abs(z(imin))))
+                    imin = i;
+            done(imin) = true;
+        }
+
+        for (int i = 0, j = 0; i < n; i++)
+            if (!done(i))
+                solns[j++] = z(i);
+
+        return countReal(solns, m);
+    }
+
+    int poly_solver::countReal(cdouble *solns, int m)
+    {
+        int res = 0;
+        for (int i = 0; i < m; i++)
+        {
+            if (std::abs(solns[i].imag()) <= 1e-9 * (1. + std::abs(solns[i].real()))) {
+                solns[i] = solns[i].real();
+                res++;
+            }
+        }
+
+        return res;
+    }
+}
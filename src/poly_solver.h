@@ -0,0 +1,44 @@
+#pragma once
+
+#include "core.h"
+
+namespace mg
+{
+    // Roots of degree n polynomials with coefficients a_n...a_0 (the evalPoly convention).
+    // Degrees up to 4 use the closed forms in algs, higher degrees use Aberth-Ehrlich
+    // iteration with a companion matrix eigenvalue fallback. Workspaces are sized once
+    // per solver so repeated and batched solves don't allocate.
+    class poly_solver
+    {
+    public:
+        poly_solver(int n, int maxIter = 100, double tol = 1e-14);
+        ~poly_solver();
+
+        static int Solve(const double *coeffs, int n, cdouble *solns);
+
+        // Finds the n roots of a polynomial. Returns the number of real roots (whose imaginary
+        // parts are set to 0), or -1 if the iteration and the fallback both failed.
+        // Leading zero coefficients lower the degree; the unused trailing roots are set to NaN.
+        int solve(const double *coeffs, cdouble *solns);
+
+        // Solves count polynomials with coefficients at coeffs + k * (n + 1) into solns + k * n.
+        // If warmStart is set, each polynomial's roots seed the next (for slowly varying batches).
+        void solve(const double *coeffs, size_t count, cdouble *solns, int *nreal = NULL, bool warmStart = false);
+
+    private:
+        const int n;
+        int maxIter;
+        double tol;
+
+        VecX a;
+        Eigen::Matrix<cdouble, -1, 1> z;
+        Eigen::Matrix<bool, -1, 1> done;
+        MatrixXX C;
+        Eigen::EigenSolver<MatrixXX> es;
+
+        // Roots of the monic degree m <= n polynomial in a
+        int aberth(cdouble *solns, int m, bool seeded);
+        int companion(cdouble *solns, int m);
+        int countReal(cdouble *solns, int m);
+    };
+}
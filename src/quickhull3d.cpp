@@ -0,0 +1,284 @@
+#include "quickhull3d.h"
+
+#include "parallel.h"
+
+#include <algorithm>
+#include <limits>
+
+quickhull3d::quickhull3d(int threads) : threads(threads), P(NULL), eps(0), mark(0) {}
+
+quickhull3d::~quickhull3d() {}
+
+bool quickhull3d::ConvexHull(const mg::VecList3f &P, mg::VecList3i &faces, std::vector<int> *vertices)
+{
+    return quickhull3d().compute(P, faces, vertices);
+}
+
+int quickhull3d::newFace(int a, int b, int c)
+{
+    int f;
+    if (!freeFaces.empty()) {
+        f = freeFaces.back();
+        freeFaces.pop_back();
+    }
+    else {
+        f = (int)faces.size();
+        faces.push_back(face());
+        vert.resize(vert.size() + 3);
+        twin.resize(twin.size() + 3);
+    }
+
+    // Edges 3f, 3f+1, 3f+2 run a->b, b->c, c->a
+    vert[3 * f] = b;
+    vert[3 * f + 1] = c;
+    vert[3 * f + 2] = a;
+
+    const mg::VecList3f &Q = *P;
+    face &F = faces[f];
+    F.normal = (Q[b] - Q[a]).cross(Q[c] - Q[a]).normalized();
+    F.offset = F.normal.dot(Q[a]);
+    F.outside = -1;
+    F.farthest = -1;
+    F.farDist = 0;
+    F.mark = 0;
+    F.alive = true;
+
+    return f;
+}
+
+void quickhull3d::freeFace(int f)
+{
+    faces[f].alive = false;
+    freeFaces.push_back(f);
+}
+
+void quickhull3d::addOutside(int f, int p, double d)
+{
+    face &F = faces[f];
+    if (F.outside < 0)
+        pending.push_back(f);
+
+    nextOut[p] = F.outside;
+    F.outside = p;
+    if (F.farthest < 0 || d > F.farDist) {
+        F.farthest = p;
+        F.farDist = d;
+    }
+}
+
+bool quickhull3d::initialSimplex(int s[4])
+{
+    const mg::VecList3f &Q = *P;
+    int n = (int)Q.size();
+
+    // The two most distant of the axis extremes
+    int ext[6] = { 0, 0, 0, 0, 0, 0 };
+    for (int i = 1; i < n; i++)
+        for (int k = 0; k < 3; k++) {
+            if (Q[i](k) < Q[ext[2 * k]](k)) ext[2 * k] = i;
+            if (Q[i](k) > Q[ext[2 * k + 1]](k)) ext[2 * k + 1] = i;
+        }
+
+    double best = -1;
+    for (int k = 0; k < 3; k++) {
+        double d = (Q[ext[2 * k + 1]] - Q[ext[2 * k]]).squaredNorm();
+        if (d > best) {
+            best = d;
+            s[0] = ext[2 * k];
+            s[1] = ext[2 * k + 1];
+        }
+    }
+    if (best <= eps * eps)
+        return false;
+
+    // Farthest from the line s0 s1
+    mg::Vec3 u = (Q[s[1]] - Q[s[0]]).normalized();
+    best = -1;
+    for (int i = 0; i < n; i++) {
+        double d = (Q[i] - Q[s[0]]).cross(u).squaredNorm();
+        if (d > best) {
+            best = d;
+            s[2] = i;
+        }
+    }
+    if (best <= eps * eps)
+        return false;
+
+    // Farthest from the plane s0 s1 s2
+    mg::Vec3 nrm = (Q[s[1]] - Q[s[0]]).cross(Q[s[2]] - Q[s[0]]).normalized();
+    best = -1;
+    for (int i = 0; i < n; i++) {
+        double d = std::abs(nrm.dot(Q[i] - Q[s[0]]));
+        if (d > best) {
+            best = d;
+            s[3] = i;
+        }
+    }
+
+    return best > eps;
+}
+
+void quickhull3d::computeHorizon(int eye, int edge0, int f)
+{
+    faces[f].mark = mark;
+    visible.push_back(f);
+
+    // Walk the face's edges starting after the one we entered through
+    int e = edge0 < 0 ? 3 * f : next(edge0);
+    int stop = edge0 < 0 ? 3 * f : edge0;
+    do
+    {
+        int t = twin[e];
+        int g = t / 3;
+        if (faces[g].mark != mark)
+        {
+            if (dist(g, eye) > eps)
+                computeHorizon(eye, t, g);
+            else
+                horizon.push_back(e);
+        }
+        e = next(e);
+    } while (e != stop);
+}
+
+void quickhull3d::addPoint(int f)
+{
+    int eye = faces[f].farthest;
+
+    mark++;
+    visible.clear();
+    horizon.clear();
+    computeHorizon(eye, -1, f);
+
+    // Fan of new faces from the horizon (counter-clockwise around the visible region) to the eye
+    created.clear();
+    for (int e : horizon)
+    {
+        int outer = twin[e];
+        int g = newFace(tail(e), vert[e], eye);
+        twin[3 * g] = outer;
+        twin[outer] = 3 * g;
+        created.push_back(g);
+    }
+    for (size_t i = 0; i < created.size(); i++)
+    {
+        int g = created[i], h = created[(i + 1) % created.size()];
+        twin[3 * g + 1] = 3 * h + 2;
+        twin[3 * h + 2] = 3 * g + 1;
+    }
+
+    // Hand the visible faces' outside points to the new faces
+    for (int v : visible)
+    {
+        for (int p = faces[v].outside; p >= 0;)
+        {
+            int pn = nextOut[p];
+            if (p != eye)
+            {
+                int best = -1;
+                double bestDist = eps;
+                for (int g : created) {
+                    double d = dist(g, p);
+                    if (d > bestDist) {
+                        bestDist = d;
+                        best = g;
+                    }
+                }
+                if (best >= 0)
+                    addOutside(best, p, bestDist);
+            }
+            p = pn;
+        }
+        freeFace(v);
+    }
+}
+
+bool quickhull3d::compute(const mg::VecList3f &Q, mg::VecList3i &out, std::vector<int> *vertices)
+{
+    P = &Q;
+    int n = (int)Q.size();
+
+    faces.clear();
+    freeFaces.clear();
+    vert.clear();
+    twin.clear();
+    pending.clear();
+    nextOut.assign(n, -1);
+    assign.assign(n, -1);
+    mark = 0;
+    out.clear();
+    if (vertices != NULL)
+        vertices->clear();
+
+    if (n < 4)
+        return false;
+
+    double scale = 0;
+    for (int k = 0; k < 3; k++) {
+        double m = 0;
+        for (int i = 0; i < n; i++)
+            m = std::max(m, std::abs(Q[i](k)));
+        scale += m;
+    }
+    eps = 3 * std::numeric_limits<double>::epsilon() * scale;
+
+    int s[4];
+    if (!initialSimplex(s))
+        return false;
+
+    // Tetrahedron with outward normals
+    if ((Q[s[1]] - Q[s[0]]).cross(Q[s[2]] - Q[s[0]]).dot(Q[s[3]] - Q[s[0]]) > 0)
+        std::swap(s[1], s[2]);
+
+    int f0 = newFace(s[0], s[1], s[2]);
+    int f1 = newFace(s[0], s[3], s[1]);
+    int f2 = newFace(s[1], s[3], s[2]);
+    int f3 = newFace(s[2], s[3], s[0]);
+    const int tw[][2] = {
+        { 3 * f0, 3 * f1 + 2 }, { 3 * f0 + 1, 3 * f2 + 2 }, { 3 * f0 + 2, 3 * f3 + 2 },
+        { 3 * f1, 3 * f3 + 1 }, { 3 * f1 + 1, 3 * f2 }, { 3 * f2 + 1, 3 * f3 } };
+    for (auto &t : tw) {
+        twin[t[0]] = t[1];
+        twin[t[1]] = t[0];
+    }
+
+    // Partition the points to the initial faces
+    mg::parallel::forRange(n, threads == 1 ? 1 : mg::parallel::threadCount(threads), [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; i++)
+        {
+            double bestDist = eps;
+            for (int f = 0; f < 4; f++) {
+                double d = dist(f, (int)i);
+                if (d > bestDist) {
+                    bestDist = d;
+                    assign[i] = f;
+                }
+            }
+        }
+    });
+    for (int i = n - 1; i >= 0; i--)
+        if (assign[i] >= 0 && i != s[0] && i != s[1] && i != s[2] && i != s[3])
+            addOutside(assign[i], i, dist(assign[i], i));
+
+    while (!pending.empty())
+    {
+        int f = pending.back();
+        pending.pop_back();
+        if (faces[f].alive && faces[f].outside >= 0)
+            addPoint(f);
+    }
+
+    for (size_t f = 0; f < faces.size(); f++)
+        if (faces[f].alive)
+            out.push_back(mg::Vec3i(vert[3 * f + 2], vert[3 * f], vert[3 * f + 1]));
+
+    if (vertices != NULL)
+    {
+        for (const mg::Vec3i &t : out)
+            vertices->insert(vertices->end(), t.data(), t.data() + 3);
+        std::sort(vertices->begin(), vertices->end());
+        vertices->erase(std::unique(vertices->begin(), vertices->end()), vertices->end());
+    }
+
+    return true;
+}
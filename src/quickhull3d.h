@@ -0,0 +1,64 @@
+#pragma once
+
+#include "core.h"
+
+// 3D convex hull by quickhull. Faces are triangles in a pooled half-edge structure
+// (face f owns half-edges 3f..3f+2, and freed faces are recycled), and each face's
+// outside set is an intrusive list through a per-point array, so building a hull makes
+// no per-face allocations. Pools are kept across compute() calls.
+class quickhull3d
+{
+public:
+    // threads > 1 (or <= 0 for hardware concurrency) partitions the points to the
+    // initial faces in parallel
+    quickhull3d(int threads = 1);
+    ~quickhull3d();
+
+    static bool ConvexHull(const mg::VecList3f &P, mg::VecList3i &faces, std::vector<int> *vertices = NULL);
+
+    // Computes the hull of P. faces receives the triangles as indices into P, counter-clockwise
+    // seen from outside (coplanar facets come out triangulated), and vertices the sorted
+    // indices of the hull vertices. Returns false if P has fewer than four non-coplanar points.
+    bool compute(const mg::VecList3f &P, mg::VecList3i &faces, std::vector<int> *vertices = NULL);
+
+private:
+    struct face
+    {
+        face() : normal(mg::Vec3::Zero()), offset(0), outside(-1), farthest(-1), farDist(0), mark(0), alive(false) {}
+
+        mg::Vec3 normal;
+        double offset;
+        int outside;    // head of the outside point list, -1 if empty
+        int farthest;   // farthest outside point
+        double farDist;
+        int mark;
+        bool alive;
+    };
+
+    int threads;
+    const mg::VecList3f *P;
+    double eps;
+
+    std::vector<face> faces;
+    std::vector<int> freeFaces;
+    std::vector<int> vert;      // head vertex of each half-edge
+    std::vector<int> twin;      // opposite half-edge
+    std::vector<int> nextOut;   // next point in the same outside list
+    std::vector<int> assign;    // initial face of each point, -1 if inside
+    std::vector<int> pending;   // faces that may have outside points
+    std::vector<int> visible, horizon, created;
+    int mark;
+
+    static int next(int e) { return e % 3 == 2 ? e - 2 : e + 1; }
+    static int prev(int e) { return e % 3 == 0 ? e + 2 : e - 1; }
+    int tail(int e) const { return vert[prev(e)]; }
+
+    double dist(int f, int p) const { return faces[f].normal.dot((*P)[p]) - faces[f].offset; }
+
+    int newFace(int a, int b, int c);
+    void freeFace(int f);
+    void addOutside(int f, int p, double d);
+    bool initialSimplex(int s[4]);
+    void computeHorizon(int eye, int edge0, int f);
+    void addPoint(int f);
+};
@@ -0,0 +1,129 @@
+#pragma once
+
+// Thin wrappers over the widest double-precision SIMD registers available at
+// compile time (AVX-512, AVX2/FMA, SSE2), with a scalar fallback.
+// Define MG_NO_SIMD to force the scalar path.
+
+#if !defined(MG_NO_SIMD) && (defined(__AVX512F__) || defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64))
+#include <immintrin.h>
+#endif
+
+#include <cmath>
+
+namespace mg
+{
+    namespace simd
+    {
+#if !defined(MG_NO_SIMD) && defined(__AVX512F__)
+        typedef __m512d packd;
+        typedef __mmask8 maskd;
+        const int width = 8;
+
+        inline packd set1(double a) { return _mm512_set1_pd(a); }
+        inline packd load(const double *p) { return _mm512_loadu_pd(p); }
+        inline packd loadStrided(const double *p, int stride)
+        {
+            return _mm512_i64gather_pd(_mm512_set_epi64(7 * stride, 6 * stride, 5 * stride, 4 * stride,
+                3 * stride, 2 * stride, stride, 0), p, 8);
+        }
+        inline void store(double *p, packd a) { _mm512_storeu_pd(p, a); }
+        inline packd add(packd a, packd b) { return _mm512_add_pd(a, b); }
+        inline packd sub(packd a, packd b) { return _mm512_sub_pd(a, b); }
+        inline packd mul(packd a, packd b) { return _mm512_mul_pd(a, b); }
+        inline packd div(packd a, packd b) { return _mm512_div_pd(a, b); }
+        inline packd fmadd(packd a, packd b, packd c) { return _mm512_fmadd_pd(a, b, c); }
+        inline packd sqrt(packd a) { return _mm512_sqrt_pd(a); }
+        inline packd abs(packd a) { return _mm512_abs_pd(a); }
+        inline packd min(packd a, packd b) { return _mm512_min_pd(a, b); }
+        inline packd max(packd a, packd b) { return _mm512_max_pd(a, b); }
+        inline maskd lt(packd a, packd b) { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+        inline maskd le(packd a, packd b) { return _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ); }
+        inline packd select(maskd m, packd a, packd b) { return _mm512_mask_blend_pd(m, b, a); }
+        inline int bits(maskd m) { return (int)m; }
+#elif !defined(MG_NO_SIMD) && defined(__AVX2__)
+        typedef __m256d packd;
+        typedef __m256d maskd;
+        const int width = 4;
+
+        inline packd set1(double a) { return _mm256_set1_pd(a); }
+        inline packd load(const double *p) { return _mm256_loadu_pd(p); }
+        inline packd loadStrided(const double *p, int stride)
+        {
+            return _mm256_i64gather_pd(p, _mm256_set_epi64x(3 * stride, 2 * stride, stride, 0), 8);
+        }
+        inline void store(double *p, packd a) { _mm256_storeu_pd(p, a); }
+        inline packd add(packd a, packd b) { return _mm256_add_pd(a, b); }
+        inline packd sub(packd a, packd b) { return _mm256_sub_pd(a, b); }
+        inline packd mul(packd a, packd b) { return _mm256_mul_pd(a, b); }
+        inline packd div(packd a, packd b) { return _mm256_div_pd(a, b); }
+#ifdef __FMA__
+        inline packd fmadd(packd a, packd b, packd c) { return _mm256_fmadd_pd(a, b, c); }
+#else
+        inline packd fmadd(packd a, packd b, packd c) { return _mm256_add_pd(_mm256_mul_pd(a, b), c); }
+#endif
+        inline packd sqrt(packd a) { return _mm256_sqrt_pd(a); }
+        inline packd abs(packd a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+        inline packd min(packd a, packd b) { return _mm256_min_pd(a, b); }
+        inline packd max(packd a, packd b) { return _mm256_max_pd(a, b); }
+        inline maskd lt(packd a, packd b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+        inline maskd le(packd a, packd b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+        inline packd select(maskd m, packd a, packd b) { return _mm256_blendv_pd(b, a, m); }
+        inline int bits(maskd m) { return _mm256_movemask_pd(m); }
+#elif !defined(MG_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+        typedef __m128d packd;
+        typedef __m128d maskd;
+        const int width = 2;
+
+        inline packd set1(double a) { return _mm_set1_pd(a); }
+        inline packd load(const double *p) { return _mm_loadu_pd(p); }
+        inline packd loadStrided(const double *p, int stride) { return _mm_set_pd(p[stride], p[0]); }
+        inline void store(double *p, packd a) { _mm_storeu_pd(p, a); }
+        inline packd add(packd a, packd b) { return _mm_add_pd(a, b); }
+        inline packd sub(packd a, packd b) { return _mm_sub_pd(a, b); }
+        inline packd mul(packd a, packd b) { return _mm_mul_pd(a, b); }
+        inline packd div(packd a, packd b) { return _mm_div_pd(a, b); }
+        inline packd fmadd(packd a, packd b, packd c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+        inline packd sqrt(packd a) { return _mm_sqrt_pd(a); }
+        inline packd abs(packd a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+        inline packd min(packd a, packd b) { return _mm_min_pd(a, b); }
+        inline packd max(packd a, packd b) { return _mm_max_pd(a, b); }
+        inline maskd lt(packd a, packd b) { return _mm_cmplt_pd(a, b); }
+        inline maskd le(packd a, packd b) { return _mm_cmple_pd(a, b); }
+        inline packd select(maskd m, packd a, packd b) { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+        inline int bits(maskd m) { return _mm_movemask_pd(m); }
+#else
+        typedef double packd;
+        typedef bool maskd;
+        const int width = 1;
+
+        inline packd set1(double a) { return a; }
+        inline packd load(const double *p) { return *p; }
+        inline packd loadStrided(const double *p, int) { return *p; }
+        inline void store(double *p, packd a) { *p = a; }
+        inline packd add(packd a, packd b) { return a + b; }
+        inline packd sub(packd a, packd b) { return a - b; }
+        inline packd mul(packd a, packd b) { return a * b; }
+        inline packd div(packd a, packd b) { return a / b; }
+        inline packd fmadd(packd a, packd b, packd c) { return a * b + c; }
+        inline packd sqrt(packd a) { return std::sqrt(a); }
+        inline packd abs(packd a) { return std::abs(a); }
+        inline packd min(packd a, packd b) { return b < a ? b : a; }
+        inline packd max(packd a, packd b) { return a < b ? b : a; }
+        inline maskd lt(packd a, packd b) { return a < b; }
+        inline maskd le(packd a, packd b) { return a <= b; }
+        inline packd select(maskd m, packd a, packd b) { return m ? a : b; }
+        inline int bits(maskd m) { return m ? 1 : 0; }
+#endif
+
+        // Horizontal sum of all lanes
+        inline double hsum(packd a)
+        {
+            double buf[width];
+            store(buf, a);
+            double s = 0;
+            for (int i = 0; i < width; i++)
+                s += buf[i];
+            return s;
+        }
+    }
+}
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <algorithm>
 #include <functional>
+#include <vector>
 
 #include "core.h"
+#include "parallel.h"
 
 using namespace mg;
 
@@ -17,9 +20,240 @@ public:
     static double Integrate(simpson2d_fn f, double u1, double u2, double v1, double v2);
     double integrate(simpson2d_fn f, double u1, double u2, double v1, double v2);
 
+    // Integrates any callable double f(double u, double v) without going through std::function
+    template<typename Fn>
+    double integrate(Fn f, double u1, double u2, double v1, double v2);
+
+    // Integrates a batch integrand that fills the whole grid at once: f(u, v, F) must set
+    // F(i, j) = f(u(i), v(j)) for the N grid nodes u, v. Allocation-free on repeated calls.
+    template<typename G>
+    double integrateBatch(G f, double u1, double u2, double v1, double v2);
+
+    // Evaluates the grid rows on threads workers (<= 0: hardware concurrency). Row partial sums
+    // are reduced in a fixed order, so the result is the same for any thread count and equal
+    // to that of integrate().
+    template<typename Fn>
+    double integrateParallel(Fn f, double u1, double u2, double v1, double v2, int threads = 0);
+
+    // Integrates a vector-valued f(u, v) -> Vec<double,K> whose K outputs share the sample points
+    template<int K, typename Fn>
+    Vec<double, K> integrateVec(Fn f, double u1, double u2, double v1, double v2, int threads = 1);
+
+    struct adaptive_result
+    {
+        double value;
+        double error;   // estimated absolute error
+        int evals;      // integrand evaluations used
+        bool converged; // tolerance met within the evaluation budget
+    };
+
+    // Globally adaptive cubature: the region with the largest error estimate (5x5 composite
+    // Simpson vs. 3x3 Simpson) is split into quadrants until the total error is below
+    // max(absTol, relTol * |value|) or another split would exceed maxEvals.
+    template<typename Fn>
+    adaptive_result integrateAdaptive(Fn f, double u1, double u2, double v1, double v2,
+        double absTol = 1e-10, double relTol = 1e-8, int maxEvals = 100000);
+
 private:
     const int N;
 
-    MatrixXX getCoefficients();
+    // Separable 1D Simpson weights (1 4 2 4 ... 2 4 1)
+    VecX w;
+
+    // Grid nodes, samples and the weighted column sums Fg * w reused by integrateBatch
+    VecX u, v;
+    MatrixXX Fg;
+    VecX Fw;
+
+    // Weighted row sums of the parallel integrators
+    VecX rows;
+    MatrixXX rowsK;
+
+    struct region
+    {
+        double u1, u2, v1, v2;
+        double f[5][5];
+        double value, error;
+
+        bool operator<(const region &r) const { return error < r.error; }
+    };
+
+    // Region heap reused across adaptive integrations
+    std::vector<region> regions;
+
+    void setNodes(double u1, double u2, double v1, double v2);
+
+    template<typename Fn>
+    static int evalRegion(Fn &f, region &r, bool coarseKnown);
 };
 
+template<typename Fn>
+double simpson2d::integrate(Fn f, double u1, double u2, double v1, double v2)
+{
+    double hu = (u2 - u1) / (N - 1);
+    double hv = (v2 - v1) / (N - 1);
+
+    double sum = 0;
+    for (int i = 0; i < N; i++)
+    {
+        double ui = u1 + i * hu;
+        double row = 0;
+        for (int j = 0; j < N; j++)
+            row += w(j) * f(ui, v1 + j * hv);
+        sum += w(i) * row;
+    }
+
+    return hu * hv / 9 * sum;
+}
+
+template<typename G>
+double simpson2d::integrateBatch(G f, double u1, double u2, double v1, double v2)
+{
+    setNodes(u1, u2, v1, v2);
+    f(u, v, Fg);
+
+    double hu = (u2 - u1) / (N - 1);
+    double hv = (v2 - v1) / (N - 1);
+
+    Fw.noalias() = Fg * w;
+    return hu * hv / 9 * w.dot(Fw);
+}
+
+template<typename Fn>
+double simpson2d::integrateParallel(Fn f, double u1, double u2, double v1, double v2, int threads)
+{
+    double hu = (u2 - u1) / (N - 1);
+    double hv = (v2 - v1) / (N - 1);
+
+    parallel::forChunks(N, threads, 1, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; i++)
+        {
+            double ui = u1 + i * hu;
+            double row = 0;
+            for (int j = 0; j < N; j++)
+                row += w(j) * f(ui, v1 + j * hv);
+            rows(i) = w(i) * row;
+        }
+    });
+
+    double sum = 0;
+    for (int i = 0; i < N; i++)
+        sum += rows(i);
+
+    return hu * hv / 9 * sum;
+}
+
+template<int K, typename Fn>
+Vec<double, K> simpson2d::integrateVec(Fn f, double u1, double u2, double v1, double v2, int threads)
+{
+    double hu = (u2 - u1) / (N - 1);
+    double hv = (v2 - v1) / (N - 1);
+
+    if (rowsK.rows() != K)
+        rowsK.resize(K, N);
+
+    parallel::forChunks(N, threads, 1, [&](size_t begin, size_t end, int) {
+        for (size_t i = begin; i < end; i++)
+        {
+            double ui = u1 + i * hu;
+            Vec<double, K> row = Vec<double, K>::Zero();
+            for (int j = 0; j < N; j++)
+                row += w(j) * f(ui, v1 + j * hv);
+            rowsK.col(i) = w(i) * row;
+        }
+    });
+
+    Vec<double, K> sum = Vec<double, K>::Zero();
+    for (int i = 0; i < N; i++)
+        sum += rowsK.col(i);
+
+    return hu * hv / 9 * sum;
+}
+
+// Samples the 5x5 grid of r (skipping the 3x3 subgrid if already known) and computes
+// its composite Simpson value and error estimate. Returns the number of evaluations.
+template<typename Fn>
+int simpson2d::evalRegion(Fn &f, region &r, bool coarseKnown)
+{
+    static const double w3[5] = { 1, 0, 4, 0, 1 };
+    static const double w5[5] = { 1, 4, 2, 4, 1 };
+
+    double hu = (r.u2 - r.u1) / 4;
+    double hv = (r.v2 - r.v1) / 4;
+
+    int evals = 0;
+    double s3 = 0, s5 = 0;
+    for (int i = 0; i < 5; i++)
+    {
+        for (int j = 0; j < 5; j++)
+        {
+            if (!coarseKnown || (i % 2) || (j % 2)) {
+                r.f[i][j] = f(r.u1 + i * hu, r.v1 + j * hv);
+                evals++;
+            }
+            s3 += w3[i] * w3[j] * r.f[i][j];
+            s5 += w5[i] * w5[j] * r.f[i][j];
+        }
+    }
+
+    s3 *= 4 * hu * hv / 9;
+    s5 *= hu * hv / 9;
+    r.value = s5;
+    r.error = std::abs(s5 - s3) / 15;
+
+    return evals;
+}
+
+template<typename Fn>
+simpson2d::adaptive_result simpson2d::integrateAdaptive(Fn f, double u1, double u2, double v1, double v2,
+    double absTol, double relTol, int maxEvals)
+{
+    regions.clear();
+
+    region r0;
+    r0.u1 = u1; r0.u2 = u2; r0.v1 = v1; r0.v2 = v2;
+    adaptive_result res;
+    res.evals = evalRegion(f, r0, false);
+    res.value = r0.value;
+    res.error = r0.error;
+    regions.push_back(r0);
+
+    while (res.error > std::max(absTol, relTol * std::abs(res.value)) && res.evals + 64 <= maxEvals)
+    {
+        std::pop_heap(regions.begin(), regions.end());
+        region p = regions.back();
+        regions.pop_back();
+        res.value -= p.value;
+        res.error -= p.error;
+
+        double um = (p.u1 + p.u2) / 2, vm = (p.v1 + p.v2) / 2;
+        for (int q = 0; q < 4; q++)
+        {
+            // Child quadrant q reuses the parent's samples as its coarse 3x3 grid
+            int qi = q & 1, qj = q >> 1;
+            region c;
+            c.u1 = qi ? um : p.u1; c.u2 = qi ? p.u2 : um;
+            c.v1 = qj ? vm : p.v1; c.v2 = qj ? p.v2 : vm;
+            for (int i = 0; i < 3; i++)
+                for (int j = 0; j < 3; j++)
+                    c.f[2 * i][2 * j] = p.f[2 * qi + i][2 * qj + j];
+
+            res.evals += evalRegion(f, c, true);
+            res.value += c.value;
+            res.error += c.error;
+            regions.push_back(c);
+            std::push_heap(regions.begin(), regions.end());
+        }
+
+        // Re-sum to keep the running error from drifting
+        if (regions.size() % 64 == 1)
+        {
+            res.error = 0;
+            for (const region &r : regions)
+                res.error += r.error;
+        }
+    }
+
+    res.converged = res.error <= std::max(absTol, relTol * std::abs(res.value));
+    return res;
+}